@@ -0,0 +1,369 @@
+// Microbenchmarks for the physics kernels.
+//
+//   microbench [--max-n N] [--output results.json]
+//
+// Every kernel runs for N = 1e2 .. 1e6 (or its own cap) and reports the
+// median, p99, mean and variance of the per-call time as JSON. Built with
+// `make ALLOCCOUNT=1` it also reports heap allocations per timed call. Mesh
+// kernels add the vertex cache miss ratio of the indices they produce.
+#include "alloccount.h"
+#include "broadphase.h"
+#include "energy.h"
+#include "mesh.h"
+#include "meshorder.h"
+#include "scenegen.h"
+#include "simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Stop sampling once both limits are met, or at maxSamples
+static const size_t minSamples = 10;
+static const size_t maxSamples = 1000;
+static const double minSeconds = 0.2;
+
+struct Stats {
+  size_t samples;
+  double median;
+  double p99;
+  double mean;
+  double variance;
+  double allocations; // Per call, counted only with COUNT_ALLOCATIONS
+};
+
+static Stats summarize(std::vector<double> &times) {
+  std::sort(times.begin(), times.end());
+  Stats stats;
+  stats.samples = times.size();
+  stats.median = times[times.size() / 2];
+  stats.p99 = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+
+  double sum = 0.0;
+  for (double time : times) {
+    sum += time;
+  }
+  stats.mean = sum / times.size();
+  double squares = 0.0;
+  for (double time : times) {
+    squares += (time - stats.mean) * (time - stats.mean);
+  }
+  stats.variance = times.size() > 1 ? squares / (times.size() - 1) : 0.0;
+  return stats;
+}
+
+static FILE *output = stdout;
+static bool firstResult = true;
+// Set before a mesh benchmark, reported with its result and then cleared
+static double resultCacheMissRatio = -1.0;
+
+static void report(const char *name, size_t n, const Stats &stats) {
+  fprintf(output,
+          "%s\n    {\"name\": \"%s\", \"n\": %zu, \"samples\": %zu, "
+          "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"mean_ns\": %.1f, "
+          "\"variance_ns2\": %.1f, \"items_per_second\": %.1f",
+          firstResult ? "" : ",", name, n, stats.samples, stats.median,
+          stats.p99, stats.mean, stats.variance, n / (stats.median * 1e-9));
+  if (allocationCountingEnabled()) {
+    fprintf(output, ", \"allocations_per_call\": %.2f", stats.allocations);
+  }
+  if (resultCacheMissRatio >= 0.0) {
+    fprintf(output, ", \"acmr\": %.3f", resultCacheMissRatio);
+  }
+  fprintf(output, "}");
+  firstResult = false;
+  fprintf(stderr, "%-24s n=%-8zu median %12.0f ns  p99 %12.0f ns", name, n,
+          stats.median, stats.p99);
+  if (allocationCountingEnabled()) {
+    fprintf(stderr, "  allocs %8.2f", stats.allocations);
+  }
+  if (resultCacheMissRatio >= 0.0) {
+    fprintf(stderr, "  acmr %.3f", resultCacheMissRatio);
+  }
+  fprintf(stderr, "\n");
+  resultCacheMissRatio = -1.0;
+}
+
+// setup() runs untimed before every sample, run() is the timed kernel
+template <typename Setup, typename Run>
+static void benchmark(const char *name, size_t n, Setup setup, Run run) {
+  setup();
+  run(); // Warm up caches and scratch buffers
+
+  std::vector<double> times;
+  times.reserve(maxSamples);
+  double total = 0.0;
+  uint64_t allocations = 0;
+  while (times.size() < maxSamples &&
+         (times.size() < minSamples || total < minSeconds)) {
+    setup();
+    uint64_t allocationsBefore = allocationCount();
+    Clock::time_point start = Clock::now();
+    run();
+    double elapsed =
+        std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    allocations += allocationCount() - allocationsBefore;
+    times.push_back(elapsed);
+    total += elapsed * 1e-9;
+  }
+  Stats stats = summarize(times);
+  stats.allocations = double(allocations) / times.size();
+  report(name, n, stats);
+}
+
+// n / 2 pairs of overlapping spheres heading into each other, through the
+// contact solver the step uses
+static void benchCollisionResponse(size_t n) {
+  SimulationState state;
+  std::vector<BodyPair> pairs;
+  for (size_t i = 0; i + 1 < n; i += 2) {
+    state.addBody(4.0f * i, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+    state.addBody(4.0f * i + 1.5f, 0.1f, 0.0f, -1.0f, 0.0f, 0.0f, 1.2f);
+    BodyPair pair = {uint32_t(i), uint32_t(i + 1)};
+    pairs.push_back(pair);
+  }
+  std::vector<float> velX = state.velX;
+  std::vector<float> velY = state.velY;
+  StepArenas arenas;
+  ContactCache warmStart; // First impact, nothing to warm start from
+  ContactSolver solver;
+
+  benchmark(
+      "collision_response", n,
+      [&] {
+        arenas.reset();
+        state.velX = velX;
+        state.velY = velY;
+      },
+      [&] {
+        buildContacts(state, pairs, warmStart, solver);
+        colorContacts(state.size(), arenas, solver);
+        solveContacts(state, solver);
+      });
+}
+
+// Cubic lattice of slightly overlapping spheres jostling their six
+// neighbours, each body in up to six contacts
+static void benchContactSolver(size_t n) {
+  SimulationState state;
+  size_t side = 1;
+  while (side * side * side < n) {
+    ++side;
+  }
+  std::mt19937 random(1);
+  std::uniform_real_distribution<float> speed(-1.0f, 1.0f);
+  for (size_t i = 0; i < n; ++i) {
+    state.addBody(0.98f * (i % side), 0.98f * (i / side % side),
+                  0.98f * (i / (side * side)), speed(random), speed(random),
+                  speed(random), 0.5f);
+  }
+  StepArenas arenas;
+  std::vector<BodyPair> pairs;
+  findPairs(BroadPhaseUniformGrid, state, arenas, pairs);
+  std::vector<float> velX = state.velX;
+  std::vector<float> velY = state.velY;
+  std::vector<float> velZ = state.velZ;
+  ContactCache warmStart;
+  ContactSolver solver;
+
+  benchmark(
+      "contact_solver", n,
+      [&] {
+        arenas.reset();
+        state.velX = velX;
+        state.velY = velY;
+        state.velZ = velZ;
+      },
+      [&] {
+        buildContacts(state, pairs, warmStart, solver);
+        colorContacts(state.size(), arenas, solver);
+        solveContacts(state, solver);
+      });
+}
+
+// One step of warm start traffic for n contacts in a chain: open a
+// generation, look up every pair and store it again
+static void benchContactCache(size_t n) {
+  ContactCache cache;
+  float found = 0.0f;
+
+  benchmark(
+      "contact_cache", n, [] {},
+      [&] {
+        cache.beginStep(n);
+        for (uint32_t i = 0; i < n; ++i) {
+          found += cache.find(i, i + 1);
+        }
+        for (uint32_t i = 0; i < n; ++i) {
+          cache.store(i, i + 1, 1.0f);
+        }
+      });
+  if (found < 0.0f) {
+    fprintf(stderr, "Error: Negative cached impulse\n");
+  }
+}
+
+// Tessellation with roughly n vertices, twice as many sectors as stacks
+static void benchSphereMesh(size_t n) {
+  int stacks = 1;
+  while (size_t(stacks + 1) * (2 * stacks + 1) < n) {
+    ++stacks;
+  }
+  SphereMesh mesh;
+  generateSphereIndices(2 * stacks, stacks, mesh);
+  size_t vertexCount = size_t(stacks + 1) * (2 * stacks + 1);
+  resultCacheMissRatio = averageCacheMissRatio(mesh.indices, vertexCount);
+  benchmark(
+      "sphere_mesh", n, [] {},
+      [&] {
+        generateSphereVertices(1.0f, 2 * stacks, stacks, mesh);
+        generateSphereIndices(2 * stacks, stacks, mesh);
+      });
+}
+
+// Subdivisions giving at most n vertices, at least the icosahedron
+static void benchIcosphere(size_t n) {
+  int subdivisions = 0;
+  while (10 * (size_t(1) << (2 * (subdivisions + 1))) + 2 <= n) {
+    ++subdivisions;
+  }
+  SphereMesh mesh;
+  generateIcosphere(1.0f, subdivisions, mesh);
+  resultCacheMissRatio =
+      averageCacheMissRatio(mesh.indices, mesh.vertices.size() / 3);
+  benchmark("icosphere_mesh", n, [] {},
+            [&] { generateIcosphere(1.0f, subdivisions, mesh); });
+}
+
+// Face grid giving roughly n vertices
+static void benchCubeSphere(size_t n) {
+  int divisions = std::max(1, int(sqrt(double(n) / 6.0) + 0.5));
+  SphereMesh mesh;
+  generateCubeSphere(1.0f, divisions, mesh);
+  resultCacheMissRatio =
+      averageCacheMissRatio(mesh.indices, mesh.vertices.size() / 3);
+  benchmark("cubesphere_mesh", n, [] {},
+            [&] { generateCubeSphere(1.0f, divisions, mesh); });
+}
+
+// Both reorders over the UV sphere's row by row indices, ~n vertices
+static void benchTriangleOrder(size_t n) {
+  int stacks = 1;
+  while (size_t(stacks + 1) * (2 * stacks + 1) < n) {
+    ++stacks;
+  }
+  SphereMesh mesh;
+  generateSphereVertices(1.0f, 2 * stacks, stacks, mesh);
+  generateSphereIndices(2 * stacks, stacks, mesh);
+  size_t vertexCount = mesh.vertices.size() / 3;
+  std::vector<unsigned int> cacheOrdered = mesh.indices;
+  optimizeVertexCache(cacheOrdered, vertexCount);
+  std::vector<unsigned int> overdrawOrdered = cacheOrdered;
+  optimizeOverdraw(overdrawOrdered, mesh.vertices);
+  std::vector<unsigned int> indices;
+
+  resultCacheMissRatio = averageCacheMissRatio(cacheOrdered, vertexCount);
+  benchmark("vertex_cache_order", n, [&] { indices = mesh.indices; },
+            [&] { optimizeVertexCache(indices, vertexCount); });
+  resultCacheMissRatio = averageCacheMissRatio(overdrawOrdered, vertexCount);
+  benchmark("overdraw_order", n, [&] { indices = cacheOrdered; },
+            [&] { optimizeOverdraw(indices, mesh.vertices); });
+  benchmark("cache_miss_ratio", n, [] {},
+            [&] { averageCacheMissRatio(overdrawOrdered, vertexCount); });
+}
+
+static void benchIntegration(size_t n) {
+  SimulationState state;
+  generateGas(state, n, 1);
+  benchmark("integration", n, [] {},
+            [&] { integrateBodies(state, 1e-4f); });
+}
+
+static void benchBroadPhase(BroadPhase broadPhase, size_t n) {
+  SimulationState state;
+  generateGas(state, n, 1);
+  StepArenas arenas;
+  std::vector<BodyPair> pairs;
+
+  char name[64];
+  snprintf(name, sizeof(name), "broadphase_%s", broadPhaseName(broadPhase));
+  benchmark(name, n, [&] { arenas.reset(); },
+            [&] { findPairs(broadPhase, state, arenas, pairs); });
+}
+
+static void benchConservation(size_t n) {
+  SimulationState state;
+  generateGas(state, n, 1);
+  std::vector<ConservationTotals> partials;
+  ConservationTotals totals;
+  benchmark("conservation_totals", n, [] {},
+            [&] { computeConservationTotals(state, partials, totals); });
+}
+
+static void benchStep(size_t n) {
+  SimulationState state;
+  generateGas(state, n, 1);
+  SimulationWorkspace workspace;
+  // One continuous run, a reset per sample would rebuild the contact cache
+  // and the buffers every time instead of timing the steady state. The
+  // first simulated second, while the gas fills in and the buffers grow,
+  // is not timed.
+  for (int step = 0; step < 60; ++step) {
+    stepSimulation(state, workspace, 1.0f / 60.0f);
+  }
+  benchmark("step", n, [] {},
+            [&] { stepSimulation(state, workspace, 1.0f / 60.0f); });
+}
+
+int main(int argc, char **argv) {
+  size_t maxN = 1000000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--max-n") == 0) {
+      maxN = strtoull(argv[i + 1], nullptr, 10);
+    } else if (strcmp(argv[i], "--output") == 0) {
+      output = fopen(argv[i + 1], "w");
+      if (!output) {
+        fprintf(stderr, "Error: Cannot open %s\n", argv[i + 1]);
+        return 1;
+      }
+    }
+  }
+
+  // The quadratic variants are capped where a single call takes seconds
+  const size_t broadPhaseMaxN[BroadPhaseCount] = {10000, 100000, 1000000};
+  // Likewise the triangle reorders, about a second per million triangles
+  const size_t meshOrderMaxN = 100000;
+
+  fprintf(output, "{\n  \"benchmarks\": [");
+  for (size_t n = 100; n <= maxN; n *= 10) {
+    benchCollisionResponse(n);
+    benchContactSolver(n);
+    benchContactCache(n);
+    benchSphereMesh(n);
+    if (n <= meshOrderMaxN) {
+      benchIcosphere(n);
+      benchCubeSphere(n);
+      benchTriangleOrder(n);
+    }
+    benchIntegration(n);
+    for (int b = 0; b < BroadPhaseCount; ++b) {
+      if (n <= broadPhaseMaxN[b]) {
+        benchBroadPhase(static_cast<BroadPhase>(b), n);
+      }
+    }
+    benchConservation(n);
+    benchStep(n);
+  }
+  fprintf(output, "\n  ]\n}\n");
+
+  if (output != stdout) {
+    fclose(output);
+  }
+  return 0;
+}
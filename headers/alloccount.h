@@ -0,0 +1,16 @@
+#ifndef ALLOCCOUNT_H
+#define ALLOCCOUNT_H
+
+#include <cstdint>
+
+// Heap allocation counter for checking that steady-state code paths stay
+// off the heap. Built with `make ALLOCCOUNT=1` (COUNT_ALLOCATIONS) it
+// replaces the global operator new; otherwise nothing is replaced and the
+// count stays 0.
+
+bool allocationCountingEnabled();
+
+// Calls to operator new made by any thread so far
+uint64_t allocationCount();
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for data that only lives until the next reset(). When a
+// block fills up another one is chained on; the next reset() folds them all
+// into a single block of the peak size, so once a workload has been seen
+// allocation never touches the heap again.
+class LinearArena {
+public:
+  explicit LinearArena(size_t initialBytes = 0);
+  ~LinearArena();
+  LinearArena(const LinearArena &) = delete;
+  LinearArena &operator=(const LinearArena &) = delete;
+
+  // Uninitialised storage for count objects, only for trivial types since
+  // nothing is ever destroyed
+  template <typename T> T *allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "arena objects are never destroyed");
+    size_t alignment = alignof(T) > minAlignment ? alignof(T) : minAlignment;
+    return static_cast<T *>(allocateBytes(count * sizeof(T), alignment));
+  }
+
+  // Drop everything allocated since the last reset
+  void reset();
+
+  size_t used() const { return usedBytes; }
+  size_t peak() const { return peakBytes; }
+
+private:
+  static const size_t minAlignment = 16;
+
+  // Chained blocks start with this header
+  struct Block {
+    Block *previous;
+    size_t size;
+  };
+
+  size_t alignedOffset(size_t alignment) const;
+  void *allocateBytes(size_t bytes, size_t alignment);
+  void addBlock(size_t minimumBytes);
+  void freeBlocks();
+
+  Block *current; // Newest block, the others hang off previous
+  size_t offset;  // Bytes taken in the current block, header included
+  size_t usedBytes;
+  size_t peakBytes;
+};
+
+// Array growing inside an arena. Growing copies into a fresh allocation and
+// abandons the old one until the arena is reset.
+template <typename T> struct ArenaArray {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "ArenaArray moves elements with memcpy");
+
+  T *data = nullptr;
+  size_t size = 0;
+  size_t capacity = 0;
+
+  void push_back(LinearArena &arena, const T &value) {
+    if (size == capacity) {
+      size_t grown = capacity ? 2 * capacity : 64;
+      T *moved = arena.allocate<T>(grown);
+      if (size) {
+        memcpy(moved, data, size * sizeof(T));
+      }
+      data = moved;
+      capacity = grown;
+    }
+    data[size++] = value;
+  }
+};
+
+// Transient memory of one simulation step: a shared arena for serial stages
+// and one per pool thread for parallelFor bodies. Reset at the start of every
+// step, so nothing allocated here may be kept across steps.
+class StepArenas {
+public:
+  StepArenas();
+
+  void reset();
+
+  LinearArena &shared() { return sharedArena; }
+  // The calling pool thread's own arena, see parallelThreadIndex()
+  LinearArena &local();
+  LinearArena &thread(size_t index) { return threadArenas[index]; }
+  size_t threadCount() const { return threadArenas.size(); }
+
+private:
+  LinearArena sharedArena;
+  std::vector<LinearArena> threadArenas;
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "glhandle.h"
+#include "texturearray.h"
+#include <GL/glew.h>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Loads textures and shaders in the background. Files are read and decoded
+// on worker threads; everything that touches GL runs in pump() on the thread
+// that owns the context, so no shared context is needed. Requests return at
+// once with a placeholder that is filled in when pump() gets to it.
+//
+// Targets handed to a request must outlive the loader: declare it after
+// them, and requests still in flight are dropped when it is destroyed.
+class AssetLoader {
+public:
+  explicit AssetLoader(size_t workerCount = 2);
+  ~AssetLoader();
+  AssetLoader(const AssetLoader &) = delete;
+  AssetLoader &operator=(const AssetLoader &) = delete;
+
+  // A texture showing one grey texel until the image is uploaded into the
+  // same name, which may keep the placeholder if the file fails to load
+  GLTexture requestTexture(const char *path);
+
+  // target gets count grey layers now and the images later
+  void requestTextureArray(TextureArray &target, const char *const *paths,
+                           int count, int layerWidth, int layerHeight);
+
+  // Sources are read and specialised for features on a worker, then built
+  // by pump() through the program cache, which hands the program to
+  // ready(). Nothing is called if the files are missing; a program that
+  // fails to build is passed as 0.
+  void requestProgram(const char *vertexPath, const char *fragmentPath,
+                      unsigned features, std::function<void(GLuint)> ready);
+
+  // Finish decoded assets on the GL thread, stopping once uploadBudget
+  // bytes have gone to the GPU so a large batch spreads over frames
+  void pump(size_t uploadBudget = 16 << 20);
+
+  // Block until every request so far is finished, for benchmarks that must
+  // not measure loading
+  void finish();
+
+  // Requests not yet finished by pump()
+  size_t pending() const;
+
+private:
+  // Result of a decode job, applied on the GL thread
+  struct Finished {
+    size_t bytes;
+    std::function<void()> apply;
+  };
+  typedef std::function<Finished()> Job;
+
+  void enqueue(Job job);
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<Job> jobs;
+  std::deque<Finished> finished;
+  mutable std::mutex mutex;
+  std::condition_variable jobReady;
+  std::condition_variable jobDone;
+  size_t outstanding; // Requested but not yet applied
+  bool stopping;
+  GLBuffer pixelBuffer;
+};
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef BAKEDMESH_H
+#define BAKEDMESH_H
+
+#include <array>
+#include <cstddef>
+
+// UV sphere meshes evaluated by the compiler, laid out exactly like
+// generateSphereVertices/generateSphereIndices output for a unit radius.
+// The arrays land in read-only data and are uploaded from there, so a
+// baked tessellation costs no geometry work at startup. Only used by
+// `make BAKED_MESH=1` builds; the runtime generator covers everything else.
+
+namespace baked {
+
+constexpr double pi = 3.14159265358979323846;
+
+// Taylor series after reducing to [-pi/4, pi/4], well below float precision
+constexpr double sinSeries(double x) {
+  double x2 = x * x, term = x, sum = x;
+  for (int n = 1; n < 12; ++n) {
+    term *= -x2 / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double cosSeries(double x) {
+  double x2 = x * x, term = 1.0, sum = 1.0;
+  for (int n = 1; n < 12; ++n) {
+    term *= -x2 / ((2 * n - 1) * (2 * n));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double sin(double x) {
+  // Quadrant of x, then the series on the remainder
+  double turns = x / (pi / 2);
+  long quadrant = (long)(turns >= 0 ? turns + 0.5 : turns - 0.5);
+  double r = x - quadrant * (pi / 2);
+  switch (((quadrant % 4) + 4) % 4) {
+  case 0:
+    return sinSeries(r);
+  case 1:
+    return cosSeries(r);
+  case 2:
+    return -sinSeries(r);
+  default:
+    return -cosSeries(r);
+  }
+}
+
+constexpr double cos(double x) { return sin(x + pi / 2); }
+
+} // namespace baked
+
+template <int Sectors, int Stacks> struct BakedSphere {
+  static constexpr size_t vertexCount = size_t(Sectors + 1) * (Stacks + 1);
+  static constexpr size_t indexCount = size_t(Sectors) * Stacks * 6;
+
+  std::array<float, vertexCount * 3> vertices;
+  std::array<float, vertexCount * 3> colors;
+  std::array<float, vertexCount * 2> textureCoords;
+  std::array<unsigned int, indexCount> indices;
+};
+
+template <int Sectors, int Stacks>
+constexpr BakedSphere<Sectors, Stacks> bakeSphere() {
+  BakedSphere<Sectors, Stacks> mesh{};
+  size_t k = 0;
+  for (int i = 0; i <= Stacks; ++i) {
+    double stackAngle = baked::pi / 2 - i * baked::pi / Stacks;
+    double xy = baked::cos(stackAngle);
+    double z = baked::sin(stackAngle);
+    for (int j = 0; j <= Sectors; ++j, ++k) {
+      // The seam column repeats the first exactly, as at runtime
+      double sectorAngle = (j % Sectors) * 2 * baked::pi / Sectors;
+      double x = xy * baked::cos(sectorAngle);
+      double y = xy * baked::sin(sectorAngle);
+      mesh.vertices[3 * k] = float(x);
+      mesh.vertices[3 * k + 1] = float(y);
+      mesh.vertices[3 * k + 2] = float(z);
+      mesh.colors[3 * k] = float(0.5 + 0.5 * x);
+      mesh.colors[3 * k + 1] = float(0.5 + 0.5 * y);
+      mesh.colors[3 * k + 2] = float(0.5 + 0.5 * z);
+      mesh.textureCoords[2 * k] = float(j) / Sectors;
+      mesh.textureCoords[2 * k + 1] = float(i) / Stacks;
+    }
+  }
+
+  size_t n = 0;
+  for (int i = 0; i < Stacks; ++i) {
+    for (int j = 0; j < Sectors; ++j) {
+      unsigned int first = i * (Sectors + 1) + j;
+      unsigned int second = first + Sectors + 1;
+      mesh.indices[n++] = first;
+      mesh.indices[n++] = second;
+      mesh.indices[n++] = first + 1;
+      mesh.indices[n++] = second;
+      mesh.indices[n++] = second + 1;
+      mesh.indices[n++] = first + 1;
+    }
+  }
+  return mesh;
+}
+
+// The unit ball mesh main.cpp draws every sphere with
+inline constexpr BakedSphere<36, 18> bakedBallSphere = bakeSphere<36, 18>();
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef BMP_H
+#define BMP_H
+
+#include <cstddef>
+
+// Read-only memory mapping of an uncompressed 24 bit BMP. The headers are
+// validated on open; pixels are read straight from the mapped pages.
+class MappedBMP {
+public:
+  MappedBMP();
+  ~MappedBMP();
+  MappedBMP(const MappedBMP &) = delete;
+  MappedBMP &operator=(const MappedBMP &) = delete;
+
+  bool open(const char *path);
+  void close();
+
+  int width() const { return imageWidth; }
+  int height() const { return imageHeight; }
+  // Bytes per stored row, padded to a multiple of 4
+  size_t stride() const { return rowStride; }
+  bool topDown() const { return isTopDown; }
+
+  // BGR pixels of the bottom row, the first one OpenGL expects
+  const unsigned char *bottomRow() const;
+  // Bytes from a row to the one above it, negative for top-down files
+  ptrdiff_t rowStep() const {
+    return isTopDown ? -(ptrdiff_t)rowStride : (ptrdiff_t)rowStride;
+  }
+
+private:
+  void *mapping;
+  size_t mappingSize;
+  const unsigned char *pixels; // First stored row
+  int imageWidth;
+  int imageHeight;
+  size_t rowStride;
+  bool isTopDown;
+};
+
+#endif
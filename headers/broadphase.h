@@ -0,0 +1,39 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class StepArenas;
+struct SimulationState;
+
+// Candidate pair of bodies whose bounding boxes overlap, with a < b
+struct BodyPair {
+  uint32_t a;
+  uint32_t b;
+};
+
+enum BroadPhase {
+  BroadPhaseBruteForce,    // Test every pair, O(n^2)
+  BroadPhaseSweepAndPrune, // Sort by x and sweep the overlapping intervals
+  BroadPhaseUniformGrid,   // Hash bodies into cells of the largest diameter
+  BroadPhaseCount
+};
+
+const char *broadPhaseName(BroadPhase broadPhase);
+
+// Every variant reports the same pairs sorted by (a, b), so the simulation
+// steps identically whichever one is used. Scratch memory comes from the
+// arenas, which the caller resets.
+void findPairs(BroadPhase broadPhase, const SimulationState &state,
+               StepArenas &arenas, std::vector<BodyPair> &pairs);
+
+void findPairsBruteForce(const SimulationState &state,
+                         std::vector<BodyPair> &pairs);
+void findPairsSweepAndPrune(const SimulationState &state, StepArenas &arenas,
+                            std::vector<BodyPair> &pairs);
+void findPairsUniformGrid(const SimulationState &state, StepArenas &arenas,
+                          std::vector<BodyPair> &pairs);
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <vector>
+
+// Snapshot of the full simulation state. Floats are stored as raw bytes so a
+// restore reproduces the original state bit for bit.
+void saveCheckpoint(const SimulationState &state,
+                    std::vector<unsigned char> &buffer);
+bool restoreCheckpoint(SimulationState &state, const unsigned char *data,
+                       size_t size);
+
+bool saveCheckpointFile(const SimulationState &state, const char *path);
+bool loadCheckpointFile(SimulationState &state, const char *path);
+
+#endif
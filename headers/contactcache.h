@@ -0,0 +1,55 @@
+#ifndef CONTACTCACHE_H
+#define CONTACTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Impulse a pair carried at the end of a step, to warm start the next
+struct ContactImpulse {
+  uint32_t a;
+  uint32_t b;
+  float impulse;
+};
+
+// Contact impulses kept from one step to the next, keyed by body pair.
+// Open addressing with linear probing; every slot is stamped with the step
+// generation that wrote it, so starting a step retires all older entries
+// without touching the table. Retired slots are reused by later inserts and
+// swept out when the table is rebuilt.
+class ContactCache {
+public:
+  // Open a new generation: what the last step stored becomes readable, and
+  // everything before it is retired. expected is a guess at the contacts
+  // this step will store.
+  void beginStep(size_t expected);
+
+  // Impulse the pair stored last step, 0 if it was not in contact
+  float find(uint32_t a, uint32_t b) const;
+  // Record the pair's impulse for the next step
+  void store(uint32_t a, uint32_t b, float impulse);
+
+  void clear();
+
+  // What the next step will read, sorted by pair, for checkpoints; assign()
+  // restores it into an empty cache
+  void entries(std::vector<ContactImpulse> &out) const;
+  void assign(const std::vector<ContactImpulse> &in);
+
+private:
+  struct Slot {
+    uint64_t key;
+    float impulse;
+    uint32_t generation; // 0 for a slot never used
+  };
+
+  std::vector<Slot> slots;     // Power of two, never more than half used
+  std::vector<Slot> survivors; // Rebuild scratch, kept for its capacity
+  size_t usedSlots = 0;        // Ever written since the last rebuild
+  uint32_t generation = 1;
+
+  // Reinsert only the readable entries, with room for expected more
+  void rebuild(size_t expected);
+};
+
+#endif
@@ -1,8 +1,29 @@
 #ifndef CONTROLS_H
 #define CONTROLS_H
 
+#include <glm/glm.hpp>
+#include <vector>
+
 void computeMatricesFromInputs();
 glm::mat4 getViewMatrix();
 glm::mat4 getProjectionMatrix();
 
+// Keyframe of a scripted camera path, for reproducible benchmark runs
+struct CameraKey {
+  float time;
+  glm::vec3 position;
+  glm::vec3 target;
+};
+
+// Text file, one "time px py pz tx ty tz" keyframe per line
+bool loadCameraPath(const char *path, std::vector<CameraKey> &keys);
+
+// Slow orbit around the origin
+void defaultCameraPath(std::vector<CameraKey> &keys);
+
+// Same outputs as computeMatricesFromInputs(), driven by the path instead of
+// the mouse. The path loops after its last keyframe.
+void computeMatricesFromPath(const std::vector<CameraKey> &keys, float time,
+                             float aspectRatio);
+
 #endif
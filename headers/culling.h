@@ -0,0 +1,27 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+
+// View frustum as six planes (a, b, c, d) with normals pointing inwards
+struct Frustum {
+  glm::vec4 planes[6];
+};
+
+// Gribb/Hartmann extraction from a view-projection matrix
+void extractFrustum(const glm::mat4 &viewProjection, Frustum &frustum);
+
+inline bool sphereInFrustum(const Frustum &frustum, const glm::vec3 &center,
+                            float radius) {
+  for (int i = 0; i < 6; ++i) {
+    const glm::vec4 &plane = frustum.planes[i];
+    if (plane.x * center.x + plane.y * center.y + plane.z * center.z +
+            plane.w <
+        -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
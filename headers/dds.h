@@ -0,0 +1,60 @@
+#ifndef DDS_H
+#define DDS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Block compressed payloads a DDS file may carry
+enum CompressedFormat { FormatBC1, FormatBC7 };
+
+// Bytes per 4x4 block
+size_t blockBytes(CompressedFormat format);
+
+// Read-only memory mapping of a DDS file holding a 2D BC1 or BC7 texture
+// with its mip chain. Levels are uploaded straight from the mapped pages.
+// Blocks are taken in OpenGL row order, bottom row first, which is how
+// texc writes them; other tools' files appear flipped.
+class MappedDDS {
+public:
+  MappedDDS();
+  ~MappedDDS();
+  MappedDDS(const MappedDDS &) = delete;
+  MappedDDS &operator=(const MappedDDS &) = delete;
+
+  bool open(const char *path);
+  void close();
+
+  CompressedFormat format() const { return blockFormat; }
+  int width() const { return baseWidth; }
+  int height() const { return baseHeight; }
+  int levelCount() const { return (int)levels.size(); }
+
+  int levelWidth(int level) const;
+  int levelHeight(int level) const;
+  const unsigned char *levelData(int level) const;
+  size_t levelSize(int level) const;
+
+private:
+  struct Level {
+    size_t offset;
+    size_t size;
+  };
+
+  void *mapping;
+  size_t mappingSize;
+  CompressedFormat blockFormat;
+  int baseWidth;
+  int baseHeight;
+  std::vector<Level> levels;
+};
+
+// Write a DDS file from already compressed levels, largest first
+bool writeDDS(const char *path, CompressedFormat format, int width, int height,
+              const std::vector<std::vector<unsigned char>> &levels);
+
+// The .dds file texc writes next to an image, path with its extension
+// replaced
+std::string compressedPath(const char *path);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SimulationState;
+
+// Conserved quantities of the whole state, using bodyMass()
+struct ConservationTotals {
+  double kinetic;
+  double potential; // Gravity, measured from the ground plane
+  double momentum[3];
+  double momentumScale; // Sum of |m v|, what momentum drift is relative to
+
+  double energy() const { return kinetic + potential; }
+};
+
+// Parallel reduction over fixed chunks of bodies. Each chunk is Kahan summed
+// and the chunk sums are added pairwise, so the result is the same for any
+// thread count. partials is scratch space reused between calls.
+void computeConservationTotals(const SimulationState &state,
+                               std::vector<ConservationTotals> &partials,
+                               ConservationTotals &totals);
+
+// Streaming check that elastic collisions conserve energy and momentum.
+// Sampling every `interval` steps keeps it cheap enough to leave on. Gravity
+// and ground bounces exchange momentum with the world, so only energy drift
+// raises the flag; momentum drift is reported for free-space scenes. What
+// bodies lose when they fall asleep, to damping or to resting contacts is
+// counted back in, settling is not drift.
+//
+// Under gravity the integrator does not keep the energy itself but
+// E - dt/2 * gravity * (vertical momentum), exactly for a falling body and
+// for one resting on the ground. Drift is measured on that, with the dt of
+// the step, so the threshold holds for any dt and gravity instead of
+// tripping on the integrator's own error.
+class EnergyMonitor {
+public:
+  explicit EnergyMonitor(uint64_t interval = 30, double threshold = 1e-3);
+
+  // Take the current state as the reference, after a load or reset
+  void reset(const SimulationState &state);
+  // Call after every step with its dt, returns true when a sample was taken
+  bool update(const SimulationState &state, float deltaTime);
+
+  // Relative to the reference, from the latest sample
+  double energyDrift() const { return energyDriftValue; }
+  double momentumDrift() const { return momentumDriftValue; }
+  // Energy drift has exceeded the threshold since the last reset
+  bool drifting() const { return driftFlag; }
+  const ConservationTotals &totals() const { return latest; }
+
+private:
+  uint64_t interval;
+  double threshold;
+  ConservationTotals reference;
+  ConservationTotals latest; // Including what slept since the reset
+  double sleptKinetic;       // The state's totals at the reset
+  double sleptMomentum[3];
+  double dissipatedEnergy;
+  std::vector<ConservationTotals> partials;
+  double energyDriftValue;
+  double momentumDriftValue;
+  bool driftFlag;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FRAMEBENCH_H
+#define FRAMEBENCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+// End-to-end frame timing for scripted benchmark runs
+
+enum FrameStage {
+  FrameStagePhysics,
+  FrameStageCulling,
+  FrameStageUpload,
+  FrameStageDraw,
+  FrameStageImGui,
+  FrameStageSwap,
+  FrameStageCount
+};
+
+const char *frameStageName(FrameStage stage);
+
+// Splits the wall clock time of a frame into consecutive stages
+class StageTimer {
+public:
+  void start();
+  // Milliseconds since start() or the previous lap()
+  double lap();
+
+private:
+  std::chrono::steady_clock::time_point last;
+};
+
+struct FrameSample {
+  double stages[FrameStageCount];
+  double cpuFrame;
+};
+
+// Collects a fixed number of frames after a warm-up and reports percentiles
+class FrameBenchmark {
+public:
+  FrameBenchmark(size_t frames, size_t warmupFrames);
+
+  bool done() const { return frameCount >= frames + warmupFrames; }
+  void addFrame(const FrameSample &sample);
+  void addGpuFrame(double milliseconds);
+
+  void printSummary() const;
+  bool writeReport(const char *path, const char *scenePath) const;
+
+private:
+  size_t frames;
+  size_t warmupFrames;
+  size_t frameCount;
+  size_t gpuFrameCount;
+  std::vector<FrameSample> samples;
+  std::vector<double> gpuSamples;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef GLHANDLE_H
+#define GLHANDLE_H
+
+#include <GL/glew.h>
+
+// Move-only owner of one GL object name. Deleting happens in the destructor,
+// so handles must go before the context does. Moving transfers ownership and
+// leaves 0 behind, copying does not compile.
+template <typename Traits> class GLHandle {
+public:
+  GLHandle() : name(0) {}
+  explicit GLHandle(GLuint name) : name(name) {}
+  ~GLHandle() { reset(); }
+
+  GLHandle(const GLHandle &) = delete;
+  GLHandle &operator=(const GLHandle &) = delete;
+  GLHandle(GLHandle &&other) noexcept : name(other.release()) {}
+  GLHandle &operator=(GLHandle &&other) noexcept {
+    if (this != &other) {
+      reset(other.release());
+    }
+    return *this;
+  }
+
+  // Generate a fresh object
+  static GLHandle create() { return GLHandle(Traits::create()); }
+
+  GLuint get() const { return name; }
+  explicit operator bool() const { return name != 0; }
+
+  // Give up ownership without deleting
+  GLuint release() {
+    GLuint released = name;
+    name = 0;
+    return released;
+  }
+
+  // Delete the current object, then own replacement
+  void reset(GLuint replacement = 0) {
+    if (name != 0) {
+      Traits::destroy(name);
+    }
+    name = replacement;
+  }
+
+private:
+  GLuint name;
+};
+
+struct GLBufferTraits {
+  static GLuint create() {
+    GLuint name = 0;
+    glGenBuffers(1, &name);
+    return name;
+  }
+  static void destroy(GLuint name) { glDeleteBuffers(1, &name); }
+};
+
+struct GLVertexArrayTraits {
+  static GLuint create() {
+    GLuint name = 0;
+    glGenVertexArrays(1, &name);
+    return name;
+  }
+  static void destroy(GLuint name) { glDeleteVertexArrays(1, &name); }
+};
+
+struct GLTextureTraits {
+  static GLuint create() {
+    GLuint name = 0;
+    glGenTextures(1, &name);
+    return name;
+  }
+  static void destroy(GLuint name) { glDeleteTextures(1, &name); }
+};
+
+struct GLProgramTraits {
+  static GLuint create() { return glCreateProgram(); }
+  static void destroy(GLuint name) { glDeleteProgram(name); }
+};
+
+typedef GLHandle<GLBufferTraits> GLBuffer;
+typedef GLHandle<GLVertexArrayTraits> GLVertexArray;
+typedef GLHandle<GLTextureTraits> GLTexture;
+typedef GLHandle<GLProgramTraits> GLProgram;
+
+#endif
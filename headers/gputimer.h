@@ -0,0 +1,82 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <GL/glew.h>
+#include <cstdint>
+
+struct ProfileTrack;
+
+// GPU time of named render passes from glQueryCounter timestamps. Each frame
+// writes into its own slot of a small pool and is read back a few frames
+// later, once the GPU has got there, so the CPU never waits on a query.
+//
+// Zones may nest. Zone names must be string literals, only the pointer is
+// stored.
+class GpuTimer {
+public:
+  static const int framesInFlight = 4;
+  static const int maxZones = 16;
+  static const int maxDepth = 8;
+
+  GpuTimer();
+  ~GpuTimer();
+  GpuTimer(const GpuTimer &) = delete;
+  GpuTimer &operator=(const GpuTimer &) = delete;
+
+  void beginFrame();
+  void beginZone(const char *name);
+  void endZone();
+  void endFrame();
+
+  // Read back the oldest finished frame, if the GPU got there yet. Its
+  // results replace the previous ones below and, with ENABLE_PROFILER, go to
+  // the "GPU" track of the trace.
+  bool resolveFrame();
+
+  // Results of the last resolved frame
+  int zoneCount() const { return resolvedCount; }
+  const char *zoneName(int zone) const { return resolvedNames[zone]; }
+  double zoneMilliseconds(int zone) const { return resolvedTimes[zone]; }
+  // From the first zone's start to the last zone's end
+  double frameMilliseconds() const { return resolvedFrame; }
+
+  // ImGui window with the smoothed time of every zone
+  void drawOverlay();
+
+private:
+  struct FrameSlot {
+    GLuint queries[2 * maxZones]; // Start and end timestamp of each zone
+    const char *names[maxZones];
+    int zoneCount;
+    GLuint lastQuery; // Issued last, the frame is done once it is available
+    bool pending;
+  };
+
+  FrameSlot slots[framesInFlight];
+  int writeSlot;
+  int readSlot;
+  bool recording; // False when every slot was still in flight
+  int openZones[maxDepth];
+  int depth;
+
+  int resolvedCount;
+  const char *resolvedNames[maxZones];
+  double resolvedTimes[maxZones];
+  double resolvedFrame;
+
+  // Exponential moving averages for the overlay, matched by name pointer
+  int smoothedCount;
+  const char *smoothedNames[maxZones];
+  double smoothedTimes[maxZones];
+  double smoothedFrame;
+
+  // GPU timestamp minus profiler clock, resynchronised now and then since
+  // the two clocks drift
+  int64_t clockOffset;
+  int framesSinceSync;
+  void syncClocks();
+
+  ProfileTrack *profileTrack; // The "GPU" track, registered on first use
+};
+
+#endif
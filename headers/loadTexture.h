@@ -1,9 +1,65 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
+#ifndef LOADTEXTURE_H
+#define LOADTEXTURE_H
 
+#include "bmp.h"
+#include "dds.h"
 #include <GL/glew.h>
+#include <cstddef>
+#include <vector>
 
-#include <GLFW/glfw3.h>
+// Upload the image to the bound GL_TEXTURE_2D's level 0 without copying it
+void uploadBMP(const MappedBMP &image);
 
+// Texture with mipmaps from a BMP file, 0 on failure
 GLuint loadBMP_custom(const char *imagepath);
+
+// Whether the driver can sample the format without decompressing it
+bool compressedFormatSupported(CompressedFormat format);
+GLenum compressedInternalFormat(CompressedFormat format);
+
+// Texture from a BC1/BC7 DDS file with its precomputed mips, 0 on failure
+GLuint loadDDS(const char *path);
+
+// The compressed .dds built next to an image when present and supported,
+// otherwise the image itself with mipmaps generated at load
+GLuint loadTexture(const char *imagepath);
+
+// Texture decoded into memory, split from the upload so the file work can
+// happen away from the GL thread
+struct TextureData {
+  struct Level {
+    int width;
+    int height;
+    size_t offset; // First layer's bytes
+    size_t size;   // Bytes per layer
+  };
+
+  int layers = 0; // 0 for a GL_TEXTURE_2D, else GL_TEXTURE_2D_ARRAY layers
+  bool compressed = false;
+  CompressedFormat format = FormatBC1;
+  // Uncompressed data is one level of packed BGR, mips are generated on
+  // upload; compressed data carries its whole chain
+  std::vector<Level> levels;
+  std::vector<unsigned char> bytes;
+};
+
+// Read a texture the way loadTexture does, preferring a supported .dds.
+// Touches no GL state, so it may run on any thread after glewInit.
+bool decodeTexture(const char *imagepath, TextureData &data);
+
+// Read the layers of a texture array at a common size. Uses the .dds files
+// when every layer has one that matches, else resizes the BMPs. A layer that
+// fails to load is grey and the result is false.
+bool decodeTextureArray(const char *const *paths, int count, int layerWidth,
+                        int layerHeight, TextureData &data);
+
+// One grey texel, or one per layer, shown until the real data arrives
+void placeholderTexture(int layers, TextureData &data);
+
+// Define the bound texture's storage from data, replacing what it held. A
+// non-zero pixelBuffer stages the bytes through that unpack buffer so the
+// driver copies them to the GPU asynchronously.
+void uploadTexture(GLuint texture, const TextureData &data,
+                   GLuint pixelBuffer = 0);
+
+#endif
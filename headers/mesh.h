@@ -0,0 +1,36 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <vector>
+
+// CPU side geometry of a UV sphere, kept free of any GL calls so it can be
+// generated and benchmarked without a context
+struct SphereMesh {
+  std::vector<float> vertices;      // x, y, z per vertex
+  std::vector<float> colors;        // r, g, b per vertex
+  std::vector<float> textureCoords; // u, v per vertex
+  std::vector<unsigned int> indices;
+};
+
+// Tessellations a Sphere can be drawn with
+enum SphereShape {
+  SphereUV,        // Sectors by stacks, generateSphereVertices
+  SphereIcosphere, // generateIcosphere
+  SphereCubeSphere // generateCubeSphere
+};
+
+// Outputs are resized in place, so regenerating into the same mesh reuses its
+// storage. Large tessellations split their stacks across the worker pool.
+void generateSphereVertices(float radius, int sectors, int stacks,
+                            SphereMesh &mesh);
+void generateSphereIndices(int sectors, int stacks, SphereMesh &mesh);
+
+// Spheres of near uniform triangles, without the UV sphere's crowded poles.
+// Same texture mapping as the UV sphere; the triangles come out ordered for
+// the vertex cache and then overdraw (meshorder.h).
+// 20 * 4^subdivisions triangles, subdivisions of an icosahedron
+void generateIcosphere(float radius, int subdivisions, SphereMesh &mesh);
+// 12 * divisions^2 triangles, a cube's face grids pushed out to the sphere
+void generateCubeSphere(float radius, int divisions, SphereMesh &mesh);
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef MESHORDER_H
+#define MESHORDER_H
+
+#include <cstddef>
+#include <vector>
+
+// Triangle orders for the GPU's post-transform vertex cache, GL free like
+// mesh.h. Indices are triangle lists, vertices x, y, z per vertex.
+
+// FIFO entries simulated by averageCacheMissRatio, a conservative guess at
+// what current hardware keeps
+const unsigned int vertexCacheSize = 16;
+
+// Reorder triangles so vertices are reused while still cached, after
+// Forsyth's linear-speed greedy optimizer. Triangles keep their winding.
+void optimizeVertexCache(std::vector<unsigned int> &indices,
+                         size_t vertexCount);
+
+// Split a cache-optimized order into clusters and draw the outward facing
+// ones first (Sander et al. 2007), so fewer fragments are shaded and then
+// covered. Clusters end where their miss ratio is within threshold of the
+// input's, which bounds the ACMR lost to the reorder.
+void optimizeOverdraw(std::vector<unsigned int> &indices,
+                      const std::vector<float> &vertices,
+                      float threshold = 1.05f);
+
+// Average cache miss ratio, vertices transformed per triangle with a FIFO
+// cache: 3 without reuse, about 0.5 at best on a closed mesh
+double averageCacheMissRatio(const std::vector<unsigned int> &indices,
+                             size_t vertexCount,
+                             unsigned int cacheSize = vertexCacheSize);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+
+// Run metrics for long unattended runs. The simulation and render loop only
+// bump relaxed atomics; a background exporter thread turns them into rates
+// and frame time percentiles every interval and writes them out as
+// Prometheus text or JSON lines, to a file and/or a local HTTP endpoint.
+
+enum MetricsFormat {
+  MetricsPrometheus, // Text exposition format, the file is replaced each time
+  MetricsJsonLines   // One JSON object appended per interval
+};
+
+struct MetricsConfig {
+  const char *path = nullptr; // File to write, none if null
+  MetricsFormat format = MetricsPrometheus;
+  int httpPort = 0;      // Serve http://127.0.0.1:port/metrics, off if 0
+  double interval = 1.0; // Seconds between samples
+};
+
+// Called from the simulation thread after every step
+void metricsRecordStep(uint64_t collisions);
+// Called from the render thread once per frame
+void metricsRecordFrame(double milliseconds);
+// Relative change of the total energy since the reference point
+void metricsSetEnergyDrift(double drift);
+
+bool startMetricsExporter(const MetricsConfig &config);
+// Writes a final sample and joins the thread
+void stopMetricsExporter();
+
+#endif
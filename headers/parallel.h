@@ -0,0 +1,36 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <type_traits>
+
+// Minimal fork-join helper on top of a persistent worker pool. Work is handed
+// out in chunks of `grain` items; the calling thread takes part as well.
+// Calls made from inside a parallel region, or while another thread owns the
+// pool, simply run serially on the caller.
+
+typedef void (*RangeFunction)(void *context, size_t begin, size_t end);
+
+void parallelForRange(size_t count, size_t grain, RangeFunction function,
+                      void *context);
+
+// Number of threads that take part in a parallelFor, including the caller
+size_t parallelThreadCount();
+
+// Index of the calling thread within the pool, 0 for the caller. Lets a body
+// pick per-thread scratch space without locking.
+size_t parallelThreadIndex();
+
+// body(begin, end) is called for consecutive sub-ranges of [0, count). No
+// allocation happens per call.
+template <typename Body>
+void parallelFor(size_t count, size_t grain, Body &&body) {
+  typedef typename std::remove_reference<Body>::type BodyType;
+  RangeFunction trampoline = [](void *context, size_t begin, size_t end) {
+    (*static_cast<BodyType *>(context))(begin, end);
+  };
+  parallelForRange(count, grain, trampoline,
+                   const_cast<void *>(static_cast<const void *>(&body)));
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef PERFWINDOW_H
+#define PERFWINDOW_H
+
+#include <cstddef>
+
+// Counters of one frame, pushed into the performance window once per frame
+struct PerfFrame {
+  double frameMilliseconds;
+  double physicsMilliseconds;
+  size_t pairs;    // Broad-phase candidate pairs
+  size_t contacts; // Pairs the solver actually resolved
+  size_t drawCalls;
+  size_t triangles;
+};
+
+// ImGui window with rolling plots of the last historyLength frames. All the
+// history lives in fixed arrays, nothing is allocated per frame.
+class PerfWindow {
+public:
+  static const int historyLength = 240;
+
+  PerfWindow();
+  ~PerfWindow();
+  PerfWindow(const PerfWindow &) = delete;
+  PerfWindow &operator=(const PerfWindow &) = delete;
+
+  void addFrame(const PerfFrame &frame);
+  void draw();
+
+private:
+  enum Series {
+    SeriesFrame,
+    SeriesPhysics,
+    SeriesPairs,
+    SeriesContacts,
+    SeriesDrawCalls,
+    SeriesTriangles,
+    SeriesMemory,
+    SeriesCount
+  };
+
+  // Ring buffers, the oldest sample is at head once they have wrapped
+  float history[SeriesCount][historyLength];
+  int head;
+
+  int statmFile; // Kept open, /proc/self/statm is re-read in place
+  long pageSize;
+  double residentMegabytes();
+};
+
+#endif
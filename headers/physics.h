@@ -1,38 +1,58 @@
 #ifndef PHYSICS_H
 #define PHYSICS_H
 
+#include "glhandle.h"
+#include "mesh.h"
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <vector>
 
+// Per-instance vertex attributes of Sphere::drawInstanced(), locations 3-7
+struct SphereInstance {
+  glm::mat4 mvp;
+  float layer; // Layer of the ball texture array
+};
+
 class Sphere {
 public:
   Sphere(float radius, int sectors, int stacks);
-  ~Sphere();
+  // Icosphere subdivisions or cube sphere divisions per face edge as detail
+  Sphere(SphereShape shape, float radius, int detail);
+
+  // Owns its GL buffers: movable, not copyable
+  Sphere(Sphere &&) = default;
+  Sphere &operator=(Sphere &&) = default;
+
+  // Regenerate the vertices for a new radius into the existing buffers
+  void setRadius(float radius);
 
   bool checkCollision(const Sphere &otherSphere);
   void generateSphere();
   void draw(GLuint programID, GLuint MatrixID, const glm::mat4 &MVP);
+  // count copies, one per SphereInstance in instanceBuffer, in one call.
+  // The caller binds the program and textures.
+  void drawInstanced(GLuint instanceBuffer, GLsizei count);
   void update(float deltaTime, float velocity); // Pass velocity during update
   void updatePosition(glm::vec3 position);
   void setTexture(GLuint textureID);
+  float getRadius() const { return radius; }
+  size_t getTriangleCount() const { return indexCount / 3; }
 
 private:
   float radius;
-  int sectors;
+  SphereShape shape;
+  int sectors; // Icosphere and cube sphere detail
   int stacks;
-  GLuint vertexArrayID;
-  GLuint vertexBuffer;
-  GLuint colorBuffer;
-  GLuint indexBuffer;
-  GLuint textureBuffer;
-  GLuint textureID;
-
-  std::vector<GLfloat> vertices;
-  std::vector<GLfloat> colors;
-  std::vector<GLuint> indices;
-  std::vector<GLfloat> textureCoords;
+  GLVertexArray vertexArray;
+  GLBuffer vertexBuffer;
+  GLBuffer colorBuffer;
+  GLBuffer indexBuffer;
+  GLBuffer textureBuffer;
+  GLuint textureID; // Not owned
+
+  SphereMesh mesh; // Empty while the buffers hold a baked mesh
+  GLsizei indexCount;
 
   glm::vec3 position; // Position of the sphere
   float angle;        // Angle of rotation around the y-axis
@@ -40,6 +60,9 @@ private:
   void generateVertices();
   void generateColors();
   void generateIndices();
+  void uploadGeometry(const float *vertices, const float *colors,
+                      const float *textureCoords, size_t vertexCount,
+                      const unsigned int *indices, size_t indexCount);
   void moveSphere(float deltaTime, float velocity);
   void rotateSphere(float deltaTime);
 };
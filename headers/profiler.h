@@ -0,0 +1,91 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+
+// Hierarchical CPU profiler. Build with `make PROFILE=1` (ENABLE_PROFILER)
+// to turn the PROFILE_* macros on; otherwise they expand to nothing and cost
+// nothing.
+//
+// Each thread records into its own lock-free ring buffer. PROFILE_COLLECT(),
+// once per frame, moves the rings' zones into growing per-thread buffers so
+// long runs keep every zone; profilerWriteChromeTrace() writes them to a
+// file that chrome://tracing and Perfetto open directly. Zone names must be
+// string literals, only the pointer is stored.
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+inline uint64_t profilerNow() { return __rdtsc(); }
+#else
+#include <chrono>
+inline uint64_t profilerNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+#endif
+
+// Record a finished zone on the calling thread. start and end are
+// profilerNow() ticks.
+void profilerRecord(const char *name, uint64_t start, uint64_t end,
+                    uint32_t depth);
+
+// Named track that is not a CPU thread, such as the GPU. Registering takes
+// a lock, keep the pointer; recording on it does not.
+struct ProfileTrack;
+ProfileTrack *profilerTrack(const char *name);
+
+// Record a zone on a track. Times are nanoseconds on the profilerElapsedNs()
+// clock. Each track must only be fed from one thread.
+void profilerRecordTrack(ProfileTrack *track, const char *name,
+                         uint64_t startNs, uint64_t endNs);
+
+// Nanoseconds since the profiler started, on the steady clock
+uint64_t profilerElapsedNs();
+
+// Name the calling thread in the exported trace
+void profilerSetThreadName(const char *name);
+
+// Move every ring's zones into its thread's collected buffer
+void profilerCollect();
+
+// Write every zone collected so far to a Chrome trace JSON file, with the
+// count of zones dropped because a ring filled up between two collections
+bool profilerWriteChromeTrace(const char *path);
+
+// RAII zone, prefer the macros below
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name)
+      : name(name), depth(currentDepth++), start(profilerNow()) {}
+  ~ProfileScope() {
+    uint64_t end = profilerNow();
+    --currentDepth;
+    profilerRecord(name, start, end, depth);
+  }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  static thread_local uint32_t currentDepth;
+  const char *name;
+  uint32_t depth;
+  uint64_t start;
+};
+
+#ifdef ENABLE_PROFILER
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name)                                                    \
+  ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__func__)
+#define PROFILE_THREAD_NAME(name) profilerSetThreadName(name)
+#define PROFILE_COLLECT() profilerCollect()
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_COLLECT() ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <GL/glew.h>
+#include <cstddef>
+#include <cstdint>
+
+// Linked programs are kept on disk with glGetProgramBinary, so later runs
+// skip compiling. Entries are keyed by a hash of both sources and the
+// driver's vendor, renderer and version strings; a missing, stale or
+// rejected entry falls back to compiling from source, and the result is
+// stored for the next run.
+
+// Directory the binaries are written to, relative to the working directory
+extern const char *programCacheDirectory;
+
+// Same contract as BuildProgram, served from the cache when possible
+GLuint LoadProgram(const char *vertexCode, const char *fragmentCode,
+                   const char *vertexName, const char *fragmentName);
+
+// 64 bit FNV-1a, continued from hash
+const uint64_t fnvOffsetBasis = 14695981039346656037ull;
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash = fnvOffsetBasis);
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+
+// Scenes describe the initial conditions of a simulation. They come in two
+// flavours:
+//
+// Text (.scene), one directive per line, '#' starts a comment:
+//   seed 42
+//   gravity 9.81
+//   ground -3
+//   damping 0.5
+//   sphere x y z vx vy vz radius
+//
+// Binary (.sceneb), produced by saveSceneBinary() or the scenec tool. The
+// file is a 64 byte header followed by one 64 byte aligned float array per
+// SceneArray, so it can be mapped and copied straight into the state.
+
+enum SceneArray {
+  ScenePosX,
+  ScenePosY,
+  ScenePosZ,
+  SceneVelX,
+  SceneVelY,
+  SceneVelZ,
+  SceneRadius,
+  SceneArrayCount
+};
+
+// Read-only memory mapping of a binary scene
+class MappedScene {
+public:
+  MappedScene();
+  ~MappedScene();
+  MappedScene(const MappedScene &) = delete;
+  MappedScene &operator=(const MappedScene &) = delete;
+
+  bool open(const char *path);
+  void close();
+
+  size_t bodyCount() const { return count; }
+  uint64_t seed() const { return rngSeed; }
+  float gravity() const { return sceneGravity; }
+  float groundY() const { return sceneGroundY; }
+  float damping() const { return sceneDamping; }
+  const float *array(SceneArray which) const;
+
+private:
+  void *mapping;
+  size_t mappingSize;
+  size_t count;
+  size_t stride;
+  uint64_t rngSeed;
+  float sceneGravity;
+  float sceneGroundY;
+  float sceneDamping;
+};
+
+// Loaders seed the state's RNG from the scene and optionally report the seed
+bool loadSceneText(SimulationState &state, const char *path,
+                   uint64_t *seed = nullptr);
+bool loadSceneBinary(SimulationState &state, const char *path,
+                     uint64_t *seed = nullptr);
+bool saveSceneText(const SimulationState &state, uint64_t seed,
+                   const char *path);
+bool saveSceneBinary(const SimulationState &state, uint64_t seed,
+                     const char *path);
+
+// Pick the loader from the file contents
+bool loadScene(SimulationState &state, const char *path,
+               uint64_t *seed = nullptr);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SCENEGEN_H
+#define SCENEGEN_H
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+
+// Procedural scenes for benchmarking at scale. Every body is computed from
+// (seed, index) alone, so the output is identical whatever the thread count
+// and generation runs in parallel.
+
+// count spheres on a cubic lattice above the ground, with small random speeds
+void generateLattice(SimulationState &state, size_t count, uint64_t seed);
+
+// Non-overlapping gas: radii uniform in [0.2, 0.5], one sphere jittered inside
+// each cell of a grid sized for the largest radius, which enforces a Poisson
+// disk style minimum distance without a sequential dart-throwing pass
+void generateGas(SimulationState &state, size_t count, uint64_t seed);
+
+// Packed square pyramid of spheres under gravity, with enough damping to
+// slump and come to rest
+void generatePile(SimulationState &state, size_t count, uint64_t seed);
+
+// Rows of touching five-ball Newton's cradles, the first ball of each row
+// swinging in
+void generateCradles(SimulationState &state, size_t count, uint64_t seed);
+
+// Triangular rack of count - 1 balls and a cue ball aimed at its apex
+void generateBilliards(SimulationState &state, size_t count, uint64_t seed);
+
+// Generate by name: lattice, gas, pile, cradle or billiards
+bool generateScene(SimulationState &state, const char *name, size_t count,
+                   uint64_t seed);
+
+#endif
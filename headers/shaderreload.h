@@ -0,0 +1,53 @@
+#ifndef SHADERRELOAD_H
+#define SHADERRELOAD_H
+
+#include "shaders.h"
+#include <GL/glew.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Rebuilds programs when their shader files change on disk, found through
+// inotify on the shader directory. A rebuilt program is handed over only
+// once it has linked, between frames, so a typo keeps the old program
+// drawing and only prints the compiler's errors.
+class ShaderReloader {
+public:
+  ShaderReloader();
+  ~ShaderReloader();
+  ShaderReloader(const ShaderReloader &) = delete;
+  ShaderReloader &operator=(const ShaderReloader &) = delete;
+
+  // Watch a directory, false with an error if it cannot be watched
+  bool start(const char *directory);
+
+  // Rebuild the features variant of these files whenever either changes.
+  // swap() receives each replacement, owns it from then on and should
+  // re-resolve its uniforms.
+  void watch(const char *vertexPath, const char *fragmentPath,
+             unsigned features, std::function<void(GLuint)> swap);
+
+  // Once per frame on the GL thread. With GL_KHR_parallel_shader_compile
+  // builds finish in the driver's threads and this never waits on them.
+  void poll();
+
+private:
+  struct Entry {
+    std::string vertexPath;
+    std::string fragmentPath;
+    unsigned features;
+    std::string vertexName; // Labels for messages
+    std::string fragmentName;
+    std::function<void(GLuint)> swap;
+    bool changed;
+    bool building;
+    ProgramBuild build;
+  };
+
+  void readEvents();
+
+  int notifyFd;
+  std::vector<Entry> entries;
+};
+
+#endif
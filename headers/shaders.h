@@ -2,8 +2,56 @@
 #define SHADERS_H
 
 #include <GL/glew.h>
+#include <string>
 
-// Function to load and compile vertex and fragment shaders
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path);
+// Features a program variant is specialised for. Each one set becomes a
+// #define of the same name in both shaders, so a variant carries no branches
+// or uniforms for features it lacks.
+enum ShaderFeature {
+    ShaderGround = 1 << 0,       // GROUND
+    ShaderInstanced = 1 << 1,    // INSTANCED
+    ShaderTextureArray = 1 << 2, // TEXTURE_ARRAY
+};
+
+// Source with the #defines for features inserted after its #version line.
+// A #line directive keeps compiler messages on the file's own lines.
+std::string SpecializeShader(const std::string& source, unsigned features);
+
+// Path followed by the feature names, to label a variant in messages
+std::string ShaderVariantName(const char* path, unsigned features);
+
+// Function to load and compile vertex and fragment shaders, reusing a
+// cached binary of the linked program when there is one (programcache.h).
+// Each feature permutation is its own program and its own cache entry.
+// Returns 0 if the files are missing or the program fails to build.
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path,
+                   unsigned features = 0);
+
+// Read a whole shader file, false with an error if it cannot be opened.
+// Touches no GL state, so it may run on any thread.
+bool ReadShaderFile(const char* path, std::string& code);
+
+// Compile and link already read sources; the names only label messages.
+// Returns 0 if either shader fails to compile or the program to link.
+GLuint BuildProgram(const char* vertex_code, const char* fragment_code,
+                    const char* vertex_name, const char* fragment_name);
+
+// Shaders and program of a build started by BeginProgram
+struct ProgramBuild {
+    GLuint program = 0;
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+};
+
+// BuildProgram in two halves, so a driver with GL_KHR_parallel_shader_compile
+// can compile in the background while frames keep drawing. BeginProgram only
+// issues the compiles and the link, ProgramBuildDone is true once EndProgram
+// will not wait (always, without the extension) and EndProgram checks the
+// result like BuildProgram.
+ProgramBuild BeginProgram(const char* vertex_code, const char* fragment_code,
+                          const char* vertex_name, const char* fragment_name);
+bool ProgramBuildDone(const ProgramBuild& build);
+GLuint EndProgram(ProgramBuild& build, const char* vertex_name,
+                  const char* fragment_name);
 
 #endif
@@ -0,0 +1,103 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "arena.h"
+#include "broadphase.h"
+#include "solver.h"
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// Complete state of the simulation. Bodies are stored as a structure of
+// arrays so the whole state can be snapshotted and restored with a handful of
+// bulk copies.
+struct SimulationState {
+  // Per-body data, all arrays have size() entries
+  std::vector<float> posX, posY, posZ;
+  std::vector<float> velX, velY, velZ;
+  std::vector<float> radius;
+  std::vector<float> rotation; // Rolling angle around the z-axis
+  std::vector<float> sleepTimer; // Seconds spent below sleepSpeed
+  std::vector<uint8_t> awake;    // 0 while the body's island sleeps
+  std::vector<uint32_t> island;  // Lowest body of a sleeper's island
+
+  // Contact impulses of the last step by pair; they warm start the solver
+  // so are part of the state
+  ContactCache contactCache;
+
+  // Kinetic energy and momentum zeroed by putting bodies to sleep, and the
+  // energy damping and resting contacts took, so the energy monitor can
+  // tell settling from drift. Diagnostics only, stepping does not read them
+  // and checkpoints do not keep them.
+  double sleptKinetic = 0.0;
+  double sleptMomentum[3] = {0.0, 0.0, 0.0};
+  double dissipatedEnergy = 0.0;
+
+  float gravity = 0.0f;  // Downward acceleration
+  float groundY = -3.0f; // Height of the ground plane
+  float damping = 0.0f;  // Drag on every velocity, per second
+
+  uint64_t stepCount = 0;
+  std::mt19937_64 rng;
+
+  size_t size() const { return radius.size(); }
+  size_t addBody(float x, float y, float z, float vx, float vy, float vz,
+                 float r);
+  void resize(size_t count);
+  void clear();
+};
+
+// Scratch data reused from one step to the next. Not part of the state, a
+// fresh workspace steps a restored state identically.
+struct SimulationWorkspace {
+  BroadPhase broadPhase = BroadPhaseUniformGrid;
+  StepArenas arenas; // Transient memory, reset at the start of every step
+  std::vector<BodyPair> pairs;
+  ContactSolver solver;
+
+  size_t contactCount = 0; // Pairs that collided during the last step
+};
+
+// The one mass model used by the solver and the diagnostics: mass grows
+// linearly with the radius rather than with the volume
+inline float bodyMass(float radius) { return radius; }
+
+// What loaders accept for a body. A zero radius divides by zero in the mass
+// and the grid's cell size, a non-finite coordinate has no grid cell.
+inline bool validRadius(float r) { return std::isfinite(r) && r > 0.0f; }
+inline bool validDamping(float d) { return std::isfinite(d) && d >= 0.0f; }
+bool validBody(const SimulationState &state, size_t i);
+
+// Bodies slower than sleepSpeed for timeToSleep seconds may sleep, but only
+// a whole contact island at once. Sleeping bodies are left out of
+// integration, ground contact, pair finding between two sleepers and the
+// solver until an awake body touches one of them; then the whole island
+// wakes in that step. The speed is above the g * dt jitter of a sphere
+// resting on the ground at 60 Hz.
+const float sleepSpeed = 0.25f;
+const float timeToSleep = 0.5f;
+
+// Wake a body after editing it from outside the simulation
+void wakeBody(SimulationState &state, size_t i);
+
+// Stages of a step, exposed individually for benchmarking
+void integrateBodies(SimulationState &state, float deltaTime);
+void collideWithGround(SimulationState &state, float deltaTime);
+void rollBodies(SimulationState &state, float deltaTime);
+// Wake every sleeping island that an awake body overlaps. Returns true if
+// any did, the pairs then miss the ones inside the woken islands.
+bool wakeTouchedIslands(SimulationState &state,
+                        const std::vector<BodyPair> &pairs,
+                        StepArenas &arenas);
+// Union-find contact islands over pairs; an island sleeps when all of its
+// bodies have rested long enough, and remembers its lowest body as its id
+void updateSleep(SimulationState &state, const std::vector<BodyPair> &pairs,
+                 StepArenas &arenas, float deltaTime);
+
+// Advance the simulation by deltaTime seconds
+void stepSimulation(SimulationState &state, SimulationWorkspace &workspace,
+                    float deltaTime);
+
+#endif
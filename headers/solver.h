@@ -0,0 +1,66 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "contactcache.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class StepArenas;
+struct BodyPair;
+struct SimulationState;
+
+// Sequential impulse contact solver. Impacts are resolved first: every
+// approaching contact gets the bounce of an isolated pair from the current
+// velocities, sweep after sweep, so an impact travels down a row of
+// touching spheres one contact at a time as in Newton's cradle. Whatever
+// still approaches is then iterated Gauss-Seidel style with clamped
+// accumulated impulses, so stacks share their load. Contacts are split into
+// colors where no two share a body, and each color is solved with
+// parallelFor without atomics; the result does not depend on the thread
+// count.
+
+// Elastic: an isolated pair comes out with the textbook elastic result
+const float contactRestitution = 1.0f;
+
+struct Contact {
+  uint32_t a;
+  uint32_t b;
+  float normal[3];      // From a to b
+  float normalMass;     // Effective mass along the normal
+  float bounceImpulse;  // Restitution, summed over the impact sweeps
+  float restingImpulse; // Holds the contact, warm started, never negative
+  float absorbed;       // Kinetic energy the resting impulse took out
+};
+
+struct ContactSolver {
+  int iterations = 8; // Impact sweeps at most, then as many resting ones
+  std::vector<Contact> contacts; // In pair order
+
+  // Filled by colorContacts: contact indices grouped by color, color c is
+  // [batchStart[c], batchStart[c + 1]); the last batch is the overflow of
+  // bodies with more contacts than colors and runs serially
+  std::vector<uint32_t> batchContacts;
+  std::vector<uint32_t> batchStart;
+};
+
+// Contacts for the pairs that overlap, impulses seeded from what the pair
+// stored in warmStart last step
+void buildContacts(const SimulationState &state,
+                   const std::vector<BodyPair> &pairs,
+                   const ContactCache &warmStart, ContactSolver &solver);
+
+// Greedy coloring in pair order, so the batches are deterministic
+void colorContacts(size_t bodyCount, StepArenas &arenas,
+                   ContactSolver &solver);
+
+// Apply the seeded impulses, sweep the impacts until none is left and then
+// iterate the resting impulses. Returns the contacts left pushing, the old
+// count of pairs that collided. The kinetic energy the resting impulses
+// absorbed is added to the state's dissipated total.
+size_t solveContacts(SimulationState &state, ContactSolver &solver);
+
+// Keep the resting impulses for the next step's warm start
+void storeContactImpulses(const ContactSolver &solver, ContactCache &cache);
+
+#endif
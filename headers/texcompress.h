@@ -0,0 +1,32 @@
+#ifndef TEXCOMPRESS_H
+#define TEXCOMPRESS_H
+
+#include <cstddef>
+
+// CPU side image processing for textures: resizing, mip chains and BC1
+// block compression. Images are tightly packed 3 byte BGR pixels, rows in
+// OpenGL order with the bottom row first.
+
+// Bilinear resize into tightly packed 3 byte pixels. sourceStride is the byte
+// distance between source rows including any padding, and may be negative.
+void resizeImage(const unsigned char *source, int sourceWidth,
+                 int sourceHeight, ptrdiff_t sourceStride,
+                 unsigned char *target, int targetWidth, int targetHeight);
+
+// Levels in a full mip chain down to 1x1
+int mipLevelCount(int width, int height);
+
+// Next mip level, max(1, width / 2) by max(1, height / 2), each pixel the
+// average of the 2x2 box above it
+void downsampleBox(const unsigned char *source, int width, int height,
+                   unsigned char *target);
+
+// Bytes of BC1 data for one level, 8 per 4x4 block
+size_t bc1Size(int width, int height);
+
+// Encode a level as BC1 blocks in row order. Partial blocks at the edges
+// repeat the last row and column.
+void compressBC1(const unsigned char *pixels, int width, int height,
+                 unsigned char *blocks);
+
+#endif
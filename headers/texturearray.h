@@ -0,0 +1,32 @@
+#ifndef TEXTUREARRAY_H
+#define TEXTUREARRAY_H
+
+#include "glhandle.h"
+#include "loadTexture.h"
+#include <GL/glew.h>
+
+// Ball textures packed as the layers of one GL_TEXTURE_2D_ARRAY, so spheres
+// with different textures are drawn with one bind and one instanced call.
+// Prebuilt .dds files of the layer size are uploaded with their mips as
+// they are; otherwise every image is resized on the CPU at load.
+class TextureArray {
+public:
+  TextureArray() : layers(0) {}
+
+  // Layer i holds paths[i]. A file that fails to load leaves a grey layer,
+  // so layer indices stay stable.
+  bool load(const char *const *paths, int count, int layerWidth,
+            int layerHeight);
+  // Replace the layers with decoded data, keeping the texture name
+  void upload(const TextureData &data, GLuint pixelBuffer = 0);
+
+  GLuint texture() const { return handle.get(); }
+  int layerCount() const { return layers; }
+  void bind(int unit) const;
+
+private:
+  GLTexture handle;
+  int layers;
+};
+
+#endif
@@ -1,10 +1,28 @@
-#include "loadTexture.h"
+#include "assets.h"
+#include "checkpoint.h"
+#include "controls.h"
+#include "culling.h"
+#include "energy.h"
+#include "framebench.h"
+#include "glhandle.h"
+#include "gputimer.h"
+#include "metrics.h"
+#include "perfwindow.h"
 #include "physics.h"
+#include "profiler.h"
+#include "scene.h"
+#include "shaderreload.h"
 #include "shaders.h"
+#include "simulation.h"
+#include "texturearray.h"
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
 
 // ImGui includes
 #include "imgui.h"
@@ -14,9 +32,6 @@
 GLFWwindow *window;
 static float lastTime = 0.0f;
 
-float sphere1Rotation = 0.0f;
-float sphere2Rotation = 0.0f;
-
 float getDeltaTime() {
   float currentTime = glfwGetTime();
   float deltaTime = currentTime - lastTime;
@@ -24,46 +39,33 @@ float getDeltaTime() {
   return deltaTime;
 }
 
-// Function to check and handle elastic collision
-void checkCollision(glm::vec3 &pos1, glm::vec3 &pos2, float &v1, float &v2,
-                    float r1, float r2) {
-  float distance = glm::distance(pos1, pos2);
-  float combinedRadius = r1 + r2;
-
-  if (distance <= combinedRadius) {
-    // Assume mass is proportional to radius
-    float m1 = r1;
-    float m2 = r2;
-
-    // Elastic collision velocity updates
-    float newV1 = v1 * (m1 - m2) / (m1 + m2) + v2 * (2 * m2) / (m1 + m2);
-    float newV2 = v2 * (m2 - m1) / (m1 + m2) + v1 * (2 * m1) / (m1 + m2);
+bool resetSimulation(bool &isRunning, bool &parametersSet,
+                     SimulationState &state, const char *scenePath) {
+  isRunning = false;
+  parametersSet = false;
 
-    v1 = newV1;
-    v2 = newV2;
+  // The controls below are built around the first two spheres
+  SimulationState loaded;
+  if (!loadScene(loaded, scenePath) || loaded.size() < 2) {
+    std::cerr << "Error: " << scenePath << " needs at least two spheres"
+              << std::endl;
+    return false;
   }
+  state = std::move(loaded);
+  return true;
 }
 
-void resetSimulation(bool &isRunning, bool &parametersSet,
-                     glm::vec3 &sphere1Pos, glm::vec3 &sphere2Pos,
-                     float &sphere1MovementSpeed, float &sphere2MovementSpeed,
-                     float &sphere1Radius, float &sphere2Radius,
-                     Sphere &sphere1, Sphere &sphere2) {
-  isRunning = false;
-  parametersSet = false;
-  sphere1Pos = glm::vec3(-20.0f, sphere1Radius, 0.0f);
-  sphere2Pos = glm::vec3(-10.0f, sphere2Radius, 0.0f);
-  sphere1MovementSpeed = 0.3f;
-  sphere2MovementSpeed = 0.3f;
-  sphere1Radius = 1.0f;
-  sphere2Radius = 1.0f;
-
-  // Reset rotation angles
-  sphere1Rotation = 0.0f;
-  sphere2Rotation = 0.0f;
-
-  sphere1 = Sphere(sphere1Radius, 36, 18);
-  sphere2 = Sphere(sphere2Radius, 36, 18);
+// Checkpoints are decoded into loaded first and only replace the state if
+// the controls still have their two spheres
+bool acceptCheckpoint(SimulationState &state, SimulationState &loaded,
+                      const char *source) {
+  if (loaded.size() < 2) {
+    std::cerr << "Error: " << source << " needs at least two spheres"
+              << std::endl;
+    return false;
+  }
+  state = std::move(loaded);
+  return true;
 }
 
 // Add ground plane vertex data
@@ -81,18 +83,19 @@ unsigned int groundIndices[] = {
 };
 
 // Function to create and configure the ground plane VAO and VBO
-void setupGroundPlane(GLuint &groundVAO, GLuint &groundVBO, GLuint &groundEBO) {
-  glGenVertexArrays(1, &groundVAO);
-  glGenBuffers(1, &groundVBO);
-  glGenBuffers(1, &groundEBO);
+void setupGroundPlane(GLVertexArray &groundVAO, GLBuffer &groundVBO,
+                      GLBuffer &groundEBO) {
+  groundVAO = GLVertexArray::create();
+  groundVBO = GLBuffer::create();
+  groundEBO = GLBuffer::create();
 
-  glBindVertexArray(groundVAO);
+  glBindVertexArray(groundVAO.get());
 
-  glBindBuffer(GL_ARRAY_BUFFER, groundVBO);
+  glBindBuffer(GL_ARRAY_BUFFER, groundVBO.get());
   glBufferData(GL_ARRAY_BUFFER, sizeof(groundVertices), groundVertices,
                GL_STATIC_DRAW);
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, groundEBO);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, groundEBO.get());
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(groundIndices), groundIndices,
                GL_STATIC_DRAW);
 
@@ -103,14 +106,15 @@ void setupGroundPlane(GLuint &groundVAO, GLuint &groundVBO, GLuint &groundEBO) {
   // Texture coordinate attribute
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
                         (void *)(3 * sizeof(float)));
-  glEnableVertexAttribArray(1);
+  glEnableVertexAttribArray(2);
 
   glBindVertexArray(0);
 }
 
 // Function to render the ground plane
 void renderGroundPlane(GLuint groundVAO, GLuint groundTexture, GLuint programID,
-                       GLuint MatrixID, glm::mat4 MVP) {
+                       GLuint MatrixID, GLint samplerID, glm::mat4 MVP) {
+  PROFILE_FUNCTION();
   glUseProgram(programID);
   glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
 
@@ -119,8 +123,7 @@ void renderGroundPlane(GLuint groundVAO, GLuint groundTexture, GLuint programID,
   glBindTexture(GL_TEXTURE_2D, groundTexture);
 
   // Set the texture sampler in the shader to use texture unit 0
-  GLuint textureLocation = glGetUniformLocation(programID, "textureSampler");
-  glUniform1i(textureLocation, 0);
+  glUniform1i(samplerID, 0);
 
   // Render the ground plane
   glBindVertexArray(groundVAO);
@@ -128,7 +131,60 @@ void renderGroundPlane(GLuint groundVAO, GLuint groundTexture, GLuint programID,
   glBindVertexArray(0);
 }
 
-int main() {
+// Usage: a.out [scene] [--frames N] [--headless] [--camera path]
+//              [--report file.json] [--trace file.json]
+//              [--metrics file] [--metrics-port N] [--ball-mesh uv|ico|cube]
+// --frames runs a scripted benchmark: the simulation starts immediately with
+// a fixed time step, the camera follows a path and after N measured frames
+// a per-stage timing report is written and the program exits.
+// --trace names the Chrome trace written at exit by PROFILE=1 builds.
+// --metrics writes run metrics every second, as JSON lines if the file name
+// ends in .jsonl and as Prometheus text otherwise; --metrics-port serves the
+// Prometheus text on http://127.0.0.1:N/metrics.
+// --ball-mesh draws the balls as an icosphere or cube sphere of about the
+// UV sphere's triangle count instead.
+int main(int argc, char **argv) {
+  const char *scenePath = "scenes/two_spheres.scene";
+  const char *cameraPath = nullptr;
+  const char *reportPath = "framebench.json";
+  const char *tracePath = "profile.json";
+  size_t benchmarkFrames = 0;
+  MetricsConfig metricsConfig;
+  bool headless = false;
+  SphereShape ballShape = SphereUV;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      benchmarkFrames = strtoull(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--camera") == 0 && i + 1 < argc) {
+      cameraPath = argv[++i];
+    } else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+      reportPath = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+      metricsConfig.path = argv[++i];
+      size_t length = strlen(metricsConfig.path);
+      if (length > 6 &&
+          strcmp(metricsConfig.path + length - 6, ".jsonl") == 0) {
+        metricsConfig.format = MetricsJsonLines;
+      }
+    } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+      metricsConfig.httpPort = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--ball-mesh") == 0 && i + 1 < argc) {
+      const char *shape = argv[++i];
+      ballShape = strcmp(shape, "ico") == 0    ? SphereIcosphere
+                  : strcmp(shape, "cube") == 0 ? SphereCubeSphere
+                                               : SphereUV;
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else {
+      scenePath = argv[i];
+    }
+  }
+  bool benchmarking = benchmarkFrames > 0;
+  const float fixedDeltaTime = 1.0f / 60.0f;
+  PROFILE_THREAD_NAME("main");
+
   if (!glfwInit()) {
     return -1;
   }
@@ -137,19 +193,31 @@ int main() {
   glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
   glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
   glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_FALSE);
+  if (headless) {
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  }
+
+  // Declared before any GL object so it is destroyed after all of them,
+  // their handles delete through the still current context
+  struct GlfwSession {
+    ~GlfwSession() { glfwTerminate(); }
+  } glfwSession;
 
   window = glfwCreateWindow(1920, 1080, "Sphere Simulation", NULL, NULL);
   if (!window) {
-    glfwTerminate();
     return -1;
   }
   glfwMakeContextCurrent(window);
 
   if (glewInit() != GLEW_OK) {
-    glfwTerminate();
     return -1;
   }
 
+  // Measure raw frame times, not the display refresh rate
+  if (benchmarking) {
+    glfwSwapInterval(0);
+  }
+
   // Setup ImGui
   IMGUI_CHECKVERSION();
   ImGui::CreateContext();
@@ -161,9 +229,51 @@ int main() {
 
   glEnable(GL_DEPTH_TEST);
 
-  GLuint programID =
-      LoadShaders("shaders/VertexShader.glsl", "shaders/FragmentShader.glsl");
-  GLuint MatrixID = glGetUniformLocation(programID, "MVP");
+  // Shaders and textures load in the background while the first frames
+  // draw. Textures start grey, and nothing is drawn with a program until it
+  // has been linked.
+  GLProgram groundProgram, ballProgram;
+  GLuint MatrixID = 0;
+  GLint groundSamplerID = -1, ballTexturesID = -1;
+  TextureArray ballTextures;
+  GLTexture groundTexture;
+  // Declared after what it fills in, so it goes first
+  AssetLoader assets;
+  // Called with each newly built program, from the loader and on reload
+  auto groundProgramReady = [&](GLuint built) {
+    groundProgram.reset(built);
+    MatrixID = glGetUniformLocation(built, "MVP");
+    groundSamplerID = glGetUniformLocation(built, "textureSampler");
+  };
+  auto ballProgramReady = [&](GLuint built) {
+    ballProgram.reset(built);
+    ballTexturesID = glGetUniformLocation(built, "textureLayers");
+  };
+  // One source pair, specialised per use
+  const char *vertexShader = "shaders/VertexShader.glsl";
+  const char *fragmentShader = "shaders/FragmentShader.glsl";
+  const unsigned groundFeatures = ShaderGround;
+  const unsigned ballFeatures = ShaderInstanced | ShaderTextureArray;
+  assets.requestProgram(vertexShader, fragmentShader, groundFeatures,
+                        groundProgramReady);
+  assets.requestProgram(vertexShader, fragmentShader, ballFeatures,
+                        ballProgramReady);
+  // Edited shaders replace the running ones, outside of benchmarks
+  ShaderReloader shaderReloader;
+  if (!benchmarking && shaderReloader.start("shaders")) {
+    shaderReloader.watch(vertexShader, fragmentShader, groundFeatures,
+                         groundProgramReady);
+    shaderReloader.watch(vertexShader, fragmentShader, ballFeatures,
+                         ballProgramReady);
+  }
+  // Body i wears texture i % layers, all in one texture array
+  const char *ballTexturePaths[] = {"textures/ball1.bmp", "textures/ball2.bmp"};
+  assets.requestTextureArray(ballTextures, ballTexturePaths, 2, 1024, 512);
+  groundTexture = assets.requestTexture("textures/concrete.bmp");
+  // Benchmarks measure frames, not loading
+  if (benchmarking) {
+    assets.finish();
+  }
 
   int width, height;
   glfwGetWindowSize(window, &width, &height);
@@ -173,125 +283,296 @@ int main() {
   glm::mat4 View =
       glm::lookAt(glm::vec3(0, 0, 40), glm::vec3(0, 0, 0), glm::vec3(0, 1, 0));
 
+  std::vector<CameraKey> cameraKeys;
+  if (!cameraPath || !loadCameraPath(cameraPath, cameraKeys)) {
+    defaultCameraPath(cameraKeys);
+  }
+
   int fbWidth, fbHeight;
   glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
   glViewport(0, 0, fbWidth, fbHeight);
 
-  float sphere1Radius = 1.0f;
-  float sphere2Radius = 1.0f;
-  float sphere1MovementSpeed = 0.3f;
-  float sphere2MovementSpeed = 0.3f;
   bool isRunning = false;
   bool parametersSet = false;
 
-  glm::vec3 sphere1Pos(-20.0f, sphere1Radius - 3.0f, 0.0f);
-  glm::vec3 sphere2Pos(-10.0f, sphere2Radius - 3.0f, 0.0f);
+  SimulationState state;
+  if (!resetSimulation(isRunning, parametersSet, state, scenePath)) {
+    return -1;
+  }
 
-  Sphere sphere1(sphere1Radius, 36, 18);
-  Sphere sphere2(sphere2Radius, 36, 18);
+  SimulationWorkspace workspace;
 
-  GLuint texture1 = loadBMP_custom("textures/ball1.bmp");
-  GLuint texture2 = loadBMP_custom("textures/ball2.bmp");
-  GLuint groundTexture = loadBMP_custom("textures/concrete.bmp");
-  sphere1.setTexture(texture1);
-  sphere2.setTexture(texture2);
+  // Drift is measured from the last time the state was replaced
+  EnergyMonitor energyMonitor;
+  energyMonitor.reset(state);
+  // Metrics were asked for, a run without them would look like a quiet one
+  if ((metricsConfig.path || metricsConfig.httpPort > 0) &&
+      !startMetricsExporter(metricsConfig)) {
+    std::cerr << "Error: Cannot start the metrics exporter" << std::endl;
+    return -1;
+  }
+
+  // In-memory snapshot taken from the controls window
+  std::vector<unsigned char> snapshot;
+
+  // One unit sphere drawn instanced for every body, scaled to its radius.
+  // 1296 triangles as a UV sphere, 1280 and 1200 for the others.
+  Sphere ballMesh = ballShape == SphereUV ? Sphere(1.0f, 36, 18)
+                    : ballShape == SphereIcosphere
+                        ? Sphere(SphereIcosphere, 1.0f, 3)
+                        : Sphere(SphereCubeSphere, 1.0f, 10);
+  GLBuffer instanceBuffer = GLBuffer::create();
+  size_t instanceCapacity = 0;
 
-  GLuint groundVAO, groundVBO, groundEBO;
+  GLVertexArray groundVAO;
+  GLBuffer groundVBO, groundEBO;
   setupGroundPlane(groundVAO, groundVBO, groundEBO);
+
+  if (benchmarking) {
+    isRunning = true;
+    parametersSet = true;
+  }
+  FrameBenchmark benchmark(benchmarkFrames, 30);
+  GpuTimer gpuTimer;
+  PerfWindow perfWindow;
+  PerfFrame perfFrame;
+  StageTimer stageTimer;
+  FrameSample frameSample;
+  size_t frameIndex = 0;
+
+  // Reused every frame
+  Frustum frustum;
+  std::vector<uint32_t> visible;
+  std::vector<SphereInstance> instances;
   do {
+    stageTimer.start();
+    perfFrame.drawCalls = 0;
+    perfFrame.triangles = 0;
+    gpuTimer.beginFrame();
+    gpuTimer.beginZone("frame");
+    assets.pump();
+    shaderReloader.poll();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    float deltaTime = getDeltaTime();
+    float deltaTime = benchmarking ? fixedDeltaTime : getDeltaTime();
 
     if (isRunning) {
-      // Update sphere positions
-      sphere1Pos.x += sphere1MovementSpeed * deltaTime;
-      sphere2Pos.x += sphere2MovementSpeed * deltaTime;
-
-      // Check for collision
-      checkCollision(sphere1Pos, sphere2Pos, sphere1MovementSpeed,
-                     sphere2MovementSpeed, sphere1Radius, sphere2Radius);
-
-      if (sphere1MovementSpeed != 0.0f) {
-        sphere1Rotation +=
-            (sphere1MovementSpeed / sphere1Radius) * deltaTime * 2.0f;
-      }
-      if (sphere2MovementSpeed != 0.0f) {
-        sphere2Rotation +=
-            (sphere2MovementSpeed / sphere2Radius) * deltaTime * 2.0f;
+      stepSimulation(state, workspace, deltaTime);
+      metricsRecordStep(workspace.contactCount);
+      if (energyMonitor.update(state, deltaTime)) {
+        metricsSetEnergyDrift(energyMonitor.energyDrift());
       }
     }
+    frameSample.stages[FrameStagePhysics] = stageTimer.lap();
 
-    // Create transformation matrices
-    glm::mat4 Model1 = glm::translate(glm::mat4(1.0f), sphere1Pos);
-    Model1 = glm::rotate(Model1, -sphere1Rotation, glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4 MVP1 = Projection * View * Model1;
-
-    glm::mat4 Model2 = glm::translate(glm::mat4(1.0f), sphere2Pos);
-    Model2 = glm::rotate(Model2, -sphere2Rotation, glm::vec3(0.0f, 0.0f, 1.0f));
-    glm::mat4 MVP2 = Projection * View * Model2;
-
-    glUseProgram(programID);
-    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP1[0][0]);
-    sphere1.draw(programID, MatrixID, MVP1);
+    if (benchmarking) {
+      computeMatricesFromPath(cameraKeys, frameIndex * fixedDeltaTime,
+                              aspectRatio);
+      View = getViewMatrix();
+      Projection = getProjectionMatrix();
+    }
+    glm::mat4 ViewProjection = Projection * View;
+
+    // Skip spheres outside the view
+    extractFrustum(ViewProjection, frustum);
+    visible.clear();
+    for (size_t i = 0; i < state.size(); ++i) {
+      glm::vec3 spherePos(state.posX[i], state.posY[i], state.posZ[i]);
+      if (sphereInFrustum(frustum, spherePos, state.radius[i])) {
+        visible.push_back(i);
+      }
+    }
+    frameSample.stages[FrameStageCulling] = stageTimer.lap();
+
+    instances.resize(visible.size());
+    for (size_t v = 0; v < visible.size(); ++v) {
+      size_t i = visible[v];
+      glm::vec3 spherePos(state.posX[i], state.posY[i], state.posZ[i]);
+      glm::mat4 Model = glm::translate(glm::mat4(1.0f), spherePos);
+      Model = glm::rotate(Model, -state.rotation[i],
+                          glm::vec3(0.0f, 0.0f, 1.0f));
+      Model = glm::scale(Model, glm::vec3(state.radius[i]));
+      instances[v].mvp = ViewProjection * Model;
+      instances[v].layer = float(i % ballTextures.layerCount());
+    }
 
-    glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP2[0][0]);
-    sphere2.draw(programID, MatrixID, MVP2);
+    // Orphan the buffer so the upload never waits on last frame's draw
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer.get());
+    if (instances.size() > instanceCapacity) {
+      instanceCapacity = std::max(instances.size(), 2 * instanceCapacity);
+    }
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(SphereInstance),
+                 nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0,
+                    instances.size() * sizeof(SphereInstance),
+                    instances.data());
+    frameSample.stages[FrameStageUpload] = stageTimer.lap();
+
+    {
+      PROFILE_SCOPE("drawSpheres");
+      gpuTimer.beginZone("spheres");
+      if (!instances.empty() && ballProgram) {
+        glUseProgram(ballProgram.get());
+        ballTextures.bind(0);
+        glUniform1i(ballTexturesID, 0);
+        ballMesh.drawInstanced(instanceBuffer.get(), instances.size());
+        perfFrame.drawCalls += 1;
+        perfFrame.triangles += instances.size() * ballMesh.getTriangleCount();
+      }
+      gpuTimer.endZone();
+    }
 
     // Render ground plane
     glm::mat4 groundModel = glm::mat4(1.0f); // Identity matrix for ground
-    glm::mat4 groundMVP = Projection * View * groundModel;
-    renderGroundPlane(groundVAO, groundTexture, programID, MatrixID, groundMVP);
+    glm::mat4 groundMVP = ViewProjection * groundModel;
+    if (groundProgram) {
+      gpuTimer.beginZone("ground");
+      renderGroundPlane(groundVAO.get(), groundTexture.get(),
+                        groundProgram.get(), MatrixID, groundSamplerID,
+                        groundMVP);
+      gpuTimer.endZone();
+      perfFrame.drawCalls += 1;
+      perfFrame.triangles += 2;
+    }
+    frameSample.stages[FrameStageDraw] = stageTimer.lap();
 
     // ImGui UI Rendering
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
+    {
+      PROFILE_SCOPE("ImGui::NewFrame");
+      ImGui_ImplOpenGL3_NewFrame();
+      ImGui_ImplGlfw_NewFrame();
+      ImGui::NewFrame();
+    }
+
+    gpuTimer.drawOverlay();
+    perfWindow.draw();
 
     ImGui::Begin("Sphere 1 Controls");
-    ImGui::SliderFloat("Speed", &sphere1MovementSpeed, 0.0f, 2.0f);
-    ImGui::SliderFloat("Radius", &sphere1Radius, 0.5f, 4.0f);
+    // Edits are not drift, measure from the edited state
+    if (ImGui::SliderFloat("Speed", &state.velX[0], 0.0f, 2.0f) |
+        ImGui::SliderFloat("Radius", &state.radius[0], 0.5f, 4.0f)) {
+      wakeBody(state, 0);
+      energyMonitor.reset(state);
+    }
     ImGui::End();
 
     ImGui::Begin("Sphere 2 Controls");
-    ImGui::SliderFloat("Speed", &sphere2MovementSpeed, 0.0f, 2.0f);
-    ImGui::SliderFloat("Radius", &sphere2Radius, 0.5f, 4.0f);
+    if (ImGui::SliderFloat("Speed", &state.velX[1], 0.0f, 2.0f) |
+        ImGui::SliderFloat("Radius", &state.radius[1], 0.5f, 4.0f)) {
+      wakeBody(state, 1);
+      energyMonitor.reset(state);
+    }
     ImGui::End();
 
     ImGui::Begin("Simulation Controls");
     if (!parametersSet) {
       if (ImGui::Button("Set Parameters")) {
-        sphere1.~Sphere(); // Explicitly destroy old object
-        sphere2.~Sphere();
-        new (&sphere1) Sphere(sphere1Radius, 36, 18);
-        new (&sphere2) Sphere(sphere2Radius, 36, 18);
-        sphere1.setTexture(texture1);
-        sphere2.setTexture(texture2);
         parametersSet = true;
-        sphere1Pos.y = sphere1Radius - 3.0f; // Keep bottom aligned
-        sphere2Pos.y = sphere2Radius - 3.0f; // Keep bottom aligned
+        // Keep bottom aligned
+        state.posY[0] = state.groundY + state.radius[0];
+        state.posY[1] = state.groundY + state.radius[1];
+        wakeBody(state, 0);
+        wakeBody(state, 1);
+        energyMonitor.reset(state);
       }
     } else {
       if (ImGui::Button(isRunning ? "Pause Simulation" : "Start Simulation")) {
         isRunning = !isRunning;
       }
       if (ImGui::Button("Reset Simulation")) {
-        resetSimulation(isRunning, parametersSet, sphere1Pos, sphere2Pos,
-                        sphere1MovementSpeed, sphere2MovementSpeed,
-                        sphere1Radius, sphere2Radius, sphere1, sphere2);
+        resetSimulation(isRunning, parametersSet, state, scenePath);
+        energyMonitor.reset(state);
+      }
+      if (ImGui::Button("Save Snapshot")) {
+        saveCheckpoint(state, snapshot);
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Restore Snapshot") && !snapshot.empty()) {
+        SimulationState loaded;
+        if (restoreCheckpoint(loaded, snapshot.data(), snapshot.size()) &&
+            acceptCheckpoint(state, loaded, "Snapshot")) {
+          energyMonitor.reset(state);
+        }
+      }
+      ImVec4 driftColor = energyMonitor.drifting()
+                              ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f)
+                              : ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+      ImGui::TextColored(driftColor, "Energy drift   %+.2e",
+                         energyMonitor.energyDrift());
+      ImGui::Text("Momentum drift %.2e", energyMonitor.momentumDrift());
+      if (ImGui::Button("Save Checkpoint File")) {
+        saveCheckpointFile(state, "checkpoint.bin");
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Load Checkpoint File")) {
+        SimulationState loaded;
+        if (loadCheckpointFile(loaded, "checkpoint.bin") &&
+            acceptCheckpoint(state, loaded, "checkpoint.bin")) {
+          energyMonitor.reset(state);
+        }
       }
     }
     ImGui::End();
 
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+      PROFILE_SCOPE("ImGui::Render");
+      gpuTimer.beginZone("imgui");
+      ImGui::Render();
+      ImDrawData *drawData = ImGui::GetDrawData();
+      ImGui_ImplOpenGL3_RenderDrawData(drawData);
+      gpuTimer.endZone();
+      for (int list = 0; list < drawData->CmdListsCount; ++list) {
+        perfFrame.drawCalls += drawData->CmdLists[list]->CmdBuffer.Size;
+      }
+      perfFrame.triangles += drawData->TotalIdxCount / 3;
+    }
+    frameSample.stages[FrameStageImGui] = stageTimer.lap();
+    gpuTimer.endZone();
+    gpuTimer.endFrame();
 
-    glfwSwapBuffers(window);
+    {
+      PROFILE_SCOPE("glfwSwapBuffers");
+      glfwSwapBuffers(window);
+    }
     glfwPollEvents();
+    frameSample.stages[FrameStageSwap] = stageTimer.lap();
+    PROFILE_COLLECT();
+
+    frameSample.cpuFrame = 0.0;
+    for (int stage = 0; stage < FrameStageCount; ++stage) {
+      frameSample.cpuFrame += frameSample.stages[stage];
+    }
+    perfFrame.frameMilliseconds = frameSample.cpuFrame;
+    perfFrame.physicsMilliseconds = frameSample.stages[FrameStagePhysics];
+    perfFrame.pairs = workspace.pairs.size();
+    perfFrame.contacts = workspace.contactCount;
+    perfWindow.addFrame(perfFrame);
+    metricsRecordFrame(frameSample.cpuFrame);
+    while (gpuTimer.resolveFrame()) {
+      benchmark.addGpuFrame(gpuTimer.frameMilliseconds());
+    }
+    ++frameIndex;
+
+    if (benchmarking) {
+      benchmark.addFrame(frameSample);
+      if (benchmark.done()) {
+        glfwSetWindowShouldClose(window, GLFW_TRUE);
+      }
+    }
   } while (!glfwWindowShouldClose(window));
 
+  stopMetricsExporter();
+  if (benchmarking) {
+    benchmark.printSummary();
+    benchmark.writeReport(reportPath, scenePath);
+  }
+#ifdef ENABLE_PROFILER
+  profilerWriteChromeTrace(tracePath);
+#else
+  (void)tracePath;
+#endif
+
   ImGui_ImplOpenGL3_Shutdown();
   ImGui_ImplGlfw_Shutdown();
   ImGui::DestroyContext();
-  glfwTerminate();
   return 0;
 }
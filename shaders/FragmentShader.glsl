@@ -1,20 +1,23 @@
-#version 410 core
-#extension GL_ARB_separate_shader_objects : enable
+#version 330 core
+// Specialised like VertexShader.glsl, see there for the defines
 
-in vec3 fragColor;        
-in vec2 TexCoord;         
+in vec2 TexCoord;
+#ifdef TEXTURE_ARRAY
+flat in float Layer;
+#endif
 
-out vec4 FragColor;       
+out vec4 FragColor;
 
-uniform sampler2D textureSampler; 
-uniform bool isGround;  // New uniform to check if it's the ground
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray textureLayers;    // One texture per layer
+#else
+uniform sampler2D textureSampler;
+#endif
 
 void main() {
-    if (isGround) {
-        vec4 texColor = texture(textureSampler, TexCoord); 
-    } else {
-        vec4 texColor = texture(textureSampler, TexCoord); 
-        FragColor = texColor;
-    }
+#ifdef TEXTURE_ARRAY
+    FragColor = texture(textureLayers, vec3(TexCoord, Layer));
+#else
+    FragColor = texture(textureSampler, TexCoord);
+#endif
 }
-
@@ -1,18 +1,35 @@
-#version 410 core
-#extension GL_ARB_separate_shader_objects : enable
+#version 330 core
+// Specialised at load by #defines injected after the #version line:
+//   GROUND         repeat the texture across the ground plane
+//   INSTANCED      per instance MVP and texture layer from attributes 3-7
+//   TEXTURE_ARRAY  pass the instance layer on, needs INSTANCED
 
 layout(location = 0) in vec3 position;   // Vertex position
-layout(location = 1) in vec3 color;      // Vertex color
 layout(location = 2) in vec2 texCoord;   // Texture coordinates
-
-out vec3 fragColor;                      // Pass color to fragment shader
-out vec2 TexCoord;                        // Pass texture coordinates
-
+#ifdef INSTANCED
+layout(location = 3) in mat4 instanceMVP;     // Per instance, locations 3-6
+layout(location = 7) in float instanceLayer;  // Texture array layer
+#else
 uniform mat4 MVP;                        // Model-View-Projection matrix
+#endif
+
+out vec2 TexCoord;                       // Pass texture coordinates
+#ifdef TEXTURE_ARRAY
+flat out float Layer;
+#endif
 
 void main() {
+#ifdef INSTANCED
+    gl_Position = instanceMVP * vec4(position, 1.0);
+#else
     gl_Position = MVP * vec4(position, 1.0); // Transform the vertex position
-    fragColor = color;                      // Pass color
-    TexCoord = texCoord;                     // Pass texture coordinates
+#endif
+#ifdef GROUND
+    TexCoord = texCoord * 10.0;          // Ten repeats across the plane
+#else
+    TexCoord = texCoord;                 // Pass texture coordinates
+#endif
+#ifdef TEXTURE_ARRAY
+    Layer = instanceLayer;
+#endif
 }
-
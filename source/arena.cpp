@@ -0,0 +1,87 @@
+#include "arena.h"
+#include "parallel.h"
+#include <cstdint>
+#include <new>
+
+// Smallest block chained on when the arena runs out
+static const size_t minBlockBytes = 64 * 1024;
+
+LinearArena::LinearArena(size_t initialBytes)
+    : current(nullptr), offset(0), usedBytes(0), peakBytes(0) {
+  if (initialBytes > 0) {
+    addBlock(initialBytes);
+  }
+}
+
+LinearArena::~LinearArena() { freeBlocks(); }
+
+void LinearArena::addBlock(size_t minimumBytes) {
+  size_t size = sizeof(Block) + minimumBytes;
+  if (size < minBlockBytes) {
+    size = minBlockBytes;
+  }
+  Block *block = static_cast<Block *>(::operator new(size));
+  block->previous = current;
+  block->size = size;
+  current = block;
+  offset = sizeof(Block);
+}
+
+void LinearArena::freeBlocks() {
+  while (current) {
+    Block *previous = current->previous;
+    ::operator delete(current);
+    current = previous;
+  }
+}
+
+size_t LinearArena::alignedOffset(size_t alignment) const {
+  if (!current) {
+    return 0;
+  }
+  uintptr_t base = reinterpret_cast<uintptr_t>(current);
+  uintptr_t mask = alignment - 1;
+  return ((base + offset + mask) & ~mask) - base;
+}
+
+void *LinearArena::allocateBytes(size_t bytes, size_t alignment) {
+  if (bytes == 0) {
+    bytes = 1;
+  }
+  size_t start = alignedOffset(alignment);
+  if (!current || start + bytes > current->size) {
+    // Room for the worst case padding in a fresh block
+    addBlock(bytes + alignment);
+    start = alignedOffset(alignment);
+  }
+  void *pointer = reinterpret_cast<char *>(current) + start;
+  usedBytes += start - offset + bytes;
+  offset = start + bytes;
+  if (usedBytes > peakBytes) {
+    peakBytes = usedBytes;
+  }
+  return pointer;
+}
+
+void LinearArena::reset() {
+  if (current && current->previous) {
+    // Spilled into more blocks, replace them with one that fits the peak
+    freeBlocks();
+    addBlock(peakBytes + peakBytes / 4);
+  }
+  offset = sizeof(Block);
+  usedBytes = 0;
+}
+
+StepArenas::StepArenas() : threadArenas(parallelThreadCount()) {}
+
+void StepArenas::reset() {
+  sharedArena.reset();
+  for (LinearArena &arena : threadArenas) {
+    arena.reset();
+  }
+}
+
+LinearArena &StepArenas::local() {
+  return threadArenas[parallelThreadIndex()];
+}
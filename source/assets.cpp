@@ -0,0 +1,170 @@
+#include "assets.h"
+#include "loadTexture.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "shaders.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+
+AssetLoader::AssetLoader(size_t workerCount)
+    : outstanding(0), stopping(false), pixelBuffer(GLBuffer::create()) {
+  for (size_t i = 0; i < workerCount; ++i) {
+    workers.emplace_back(&AssetLoader::workerLoop, this);
+  }
+}
+
+AssetLoader::~AssetLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    jobs.clear();
+  }
+  jobReady.notify_all();
+  for (std::thread &worker : workers) {
+    worker.join();
+  }
+}
+
+void AssetLoader::enqueue(Job job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.push_back(std::move(job));
+    ++outstanding;
+  }
+  jobReady.notify_one();
+}
+
+void AssetLoader::workerLoop() {
+  PROFILE_THREAD_NAME("assets");
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    jobReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+    if (stopping) {
+      return;
+    }
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+
+    lock.unlock();
+    Finished result;
+    {
+      PROFILE_SCOPE("decodeAsset");
+      result = job();
+    }
+    lock.lock();
+    finished.push_back(std::move(result));
+    jobDone.notify_all();
+  }
+}
+
+GLTexture AssetLoader::requestTexture(const char *path) {
+  GLTexture texture = GLTexture::create();
+  TextureData placeholder;
+  placeholderTexture(0, placeholder);
+  uploadTexture(texture.get(), placeholder);
+
+  GLuint name = texture.get();
+  std::string file(path);
+  GLuint stagingBuffer = pixelBuffer.get();
+  enqueue([name, file, stagingBuffer]() -> Finished {
+    // Shared so the apply step stays copyable for std::function
+    auto data = std::make_shared<TextureData>();
+    if (!decodeTexture(file.c_str(), *data)) {
+      return {0, [] {}};
+    }
+    return {data->bytes.size(), [name, data, stagingBuffer] {
+              uploadTexture(name, *data, stagingBuffer);
+            }};
+  });
+  return texture;
+}
+
+void AssetLoader::requestTextureArray(TextureArray &target,
+                                      const char *const *paths, int count,
+                                      int layerWidth, int layerHeight) {
+  TextureData placeholder;
+  placeholderTexture(count, placeholder);
+  target.upload(placeholder);
+
+  std::vector<std::string> files(paths, paths + count);
+  TextureArray *array = &target;
+  GLuint stagingBuffer = pixelBuffer.get();
+  enqueue([array, files, layerWidth, layerHeight,
+           stagingBuffer]() -> Finished {
+    std::vector<const char *> pointers;
+    for (const std::string &file : files) {
+      pointers.push_back(file.c_str());
+    }
+    auto data = std::make_shared<TextureData>();
+    decodeTextureArray(pointers.data(), (int)pointers.size(), layerWidth,
+                       layerHeight, *data);
+    return {data->bytes.size(), [array, data, stagingBuffer] {
+              array->upload(*data, stagingBuffer);
+            }};
+  });
+}
+
+void AssetLoader::requestProgram(const char *vertexPath,
+                                 const char *fragmentPath, unsigned features,
+                                 std::function<void(GLuint)> ready) {
+  std::string vertexFile(vertexPath), fragmentFile(fragmentPath);
+  enqueue([vertexFile, fragmentFile, features, ready]() -> Finished {
+    auto vertexCode = std::make_shared<std::string>();
+    auto fragmentCode = std::make_shared<std::string>();
+    if (!ReadShaderFile(vertexFile.c_str(), *vertexCode) ||
+        !ReadShaderFile(fragmentFile.c_str(), *fragmentCode)) {
+      return {0, [] {}};
+    }
+    *vertexCode = SpecializeShader(*vertexCode, features);
+    *fragmentCode = SpecializeShader(*fragmentCode, features);
+    std::string vertexName = ShaderVariantName(vertexFile.c_str(), features);
+    std::string fragmentName =
+        ShaderVariantName(fragmentFile.c_str(), features);
+    return {0, [=] {
+              ready(LoadProgram(vertexCode->c_str(), fragmentCode->c_str(),
+                                vertexName.c_str(), fragmentName.c_str()));
+            }};
+  });
+}
+
+void AssetLoader::pump(size_t uploadBudget) {
+  PROFILE_FUNCTION();
+  size_t uploaded = 0;
+  while (uploaded < uploadBudget) {
+    Finished next;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (finished.empty()) {
+        return;
+      }
+      next = std::move(finished.front());
+      finished.pop_front();
+    }
+    next.apply();
+    uploaded += next.bytes;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    --outstanding;
+  }
+}
+
+void AssetLoader::finish() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobDone.wait(lock, [this] {
+        return outstanding == 0 || !finished.empty();
+      });
+      if (outstanding == 0) {
+        return;
+      }
+    }
+    pump(SIZE_MAX);
+  }
+}
+
+size_t AssetLoader::pending() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return outstanding;
+}
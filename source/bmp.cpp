@@ -0,0 +1,114 @@
+#include "bmp.h"
+#include <cstdint>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Fields are little-endian and unaligned in the file
+static uint32_t readLE32(const unsigned char *bytes) {
+  return uint32_t(bytes[0]) | uint32_t(bytes[1]) << 8 |
+         uint32_t(bytes[2]) << 16 | uint32_t(bytes[3]) << 24;
+}
+
+static uint16_t readLE16(const unsigned char *bytes) {
+  return uint16_t(bytes[0] | bytes[1] << 8);
+}
+
+// File header plus the BITMAPINFOHEADER every later header version extends
+static const size_t fileHeaderSize = 14;
+static const size_t infoHeaderSize = 40;
+static const int maxDimension = 1 << 15;
+
+MappedBMP::MappedBMP()
+    : mapping(nullptr), mappingSize(0), pixels(nullptr), imageWidth(0),
+      imageHeight(0), rowStride(0), isTopDown(false) {}
+
+MappedBMP::~MappedBMP() { close(); }
+
+bool MappedBMP::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < fileHeaderSize + infoHeaderSize) {
+    std::cerr << "Error: " << path << " is not a BMP file" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  // The whole file is about to be uploaded, fault it in up front
+  size_t size = info.st_size;
+  void *data =
+      mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Error: Cannot map " << path << std::endl;
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  uint32_t dataOffset = readLE32(bytes + 10);
+  uint32_t headerSize = readLE32(bytes + 14);
+  int32_t width = (int32_t)readLE32(bytes + 18);
+  int32_t height = (int32_t)readLE32(bytes + 22);
+  uint16_t planes = readLE16(bytes + 26);
+  uint16_t bitsPerPixel = readLE16(bytes + 28);
+  uint32_t compression = readLE32(bytes + 30);
+
+  const char *problem = nullptr;
+  if (bytes[0] != 'B' || bytes[1] != 'M') {
+    problem = "is not a BMP file";
+  } else if (headerSize < infoHeaderSize || planes != 1) {
+    problem = "has an unsupported BMP header";
+  } else if (bitsPerPixel != 24 || compression != 0) {
+    problem = "is not an uncompressed 24 bit BMP";
+  } else if (width <= 0 || width > maxDimension || height == 0 ||
+             height < -maxDimension || height > maxDimension) {
+    problem = "has invalid BMP dimensions";
+  }
+  size_t rows = height < 0 ? -(int64_t)height : height;
+  size_t stride = (size_t(width) * 3 + 3) & ~size_t(3);
+  if (!problem && (dataOffset < fileHeaderSize + headerSize ||
+                   dataOffset > size || size - dataOffset < stride * rows)) {
+    problem = "is truncated";
+  }
+  if (problem) {
+    std::cerr << "Error: " << path << " " << problem << std::endl;
+    munmap(data, size);
+    return false;
+  }
+
+  mapping = data;
+  mappingSize = size;
+  pixels = bytes + dataOffset;
+  imageWidth = width;
+  imageHeight = (int)rows;
+  rowStride = stride;
+  isTopDown = height < 0;
+  return true;
+}
+
+void MappedBMP::close() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+  pixels = nullptr;
+  imageWidth = 0;
+  imageHeight = 0;
+  rowStride = 0;
+  isTopDown = false;
+}
+
+const unsigned char *MappedBMP::bottomRow() const {
+  return isTopDown ? pixels + (imageHeight - 1) * rowStride : pixels;
+}
@@ -0,0 +1,245 @@
+#include "broadphase.h"
+#include "arena.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <new>
+
+const char *broadPhaseName(BroadPhase broadPhase) {
+  switch (broadPhase) {
+  case BroadPhaseBruteForce:
+    return "brute_force";
+  case BroadPhaseSweepAndPrune:
+    return "sweep_and_prune";
+  case BroadPhaseUniformGrid:
+    return "uniform_grid";
+  default:
+    return "unknown";
+  }
+}
+
+// Axis aligned bounding boxes of two spheres overlap
+static inline bool boxesOverlap(const SimulationState &state, size_t i,
+                                size_t j) {
+  float reach = state.radius[i] + state.radius[j];
+  return std::fabs(state.posX[i] - state.posX[j]) <= reach &&
+         std::fabs(state.posY[i] - state.posY[j]) <= reach &&
+         std::fabs(state.posZ[i] - state.posZ[j]) <= reach;
+}
+
+// Two sleepers need no pair, they rest against each other as they are
+static inline bool eitherAwake(const SimulationState &state, size_t i,
+                               size_t j) {
+  return state.awake[i] || state.awake[j];
+}
+
+static inline BodyPair makePair(uint32_t i, uint32_t j) {
+  BodyPair pair;
+  pair.a = std::min(i, j);
+  pair.b = std::max(i, j);
+  return pair;
+}
+
+static void sortPairs(std::vector<BodyPair> &pairs) {
+  std::sort(pairs.begin(), pairs.end(),
+            [](const BodyPair &left, const BodyPair &right) {
+              return left.a != right.a ? left.a < right.a : left.b < right.b;
+            });
+}
+
+void findPairsBruteForce(const SimulationState &state,
+                         std::vector<BodyPair> &pairs) {
+  pairs.clear();
+  uint32_t count = state.size();
+  for (uint32_t i = 0; i < count; ++i) {
+    for (uint32_t j = i + 1; j < count; ++j) {
+      if (eitherAwake(state, i, j) && boxesOverlap(state, i, j)) {
+        pairs.push_back(makePair(i, j));
+      }
+    }
+  }
+}
+
+void findPairsSweepAndPrune(const SimulationState &state, StepArenas &arenas,
+                            std::vector<BodyPair> &pairs) {
+  pairs.clear();
+  uint32_t count = state.size();
+  const float *posX = state.posX.data();
+  const float *radius = state.radius.data();
+
+  // Sort by the left edge of each box along x
+  uint32_t *order = arenas.shared().allocate<uint32_t>(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  std::sort(order, order + count, [&](uint32_t left, uint32_t right) {
+    return posX[left] - radius[left] < posX[right] - radius[right];
+  });
+
+  // Only boxes starting before this one ends can overlap it along x
+  for (uint32_t k = 0; k < count; ++k) {
+    uint32_t i = order[k];
+    float maxX = posX[i] + radius[i];
+    for (uint32_t m = k + 1; m < count; ++m) {
+      uint32_t j = order[m];
+      if (posX[j] - radius[j] > maxX) {
+        break;
+      }
+      if (eitherAwake(state, i, j) && boxesOverlap(state, i, j)) {
+        pairs.push_back(makePair(i, j));
+      }
+    }
+  }
+  sortPairs(pairs);
+}
+
+// Cell coordinates packed 21 bits per axis, unique within +-2^20 cells
+static inline uint64_t cellKey(int32_t x, int32_t y, int32_t z) {
+  const uint64_t mask = (1u << 21) - 1;
+  return ((uint64_t)x & mask) | (((uint64_t)y & mask) << 21) |
+         (((uint64_t)z & mask) << 42);
+}
+
+// The cell itself followed by the 13 neighbours with a positive offset, then
+// the 13 with a negative one
+static const int fullShell[27][3] = {
+    {0, 0, 0},    {1, 0, 0},   {-1, 1, 0},  {0, 1, 0},   {1, 1, 0},
+    {-1, -1, 1},  {0, -1, 1},  {1, -1, 1},  {-1, 0, 1},  {0, 0, 1},
+    {1, 0, 1},    {-1, 1, 1},  {0, 1, 1},   {1, 1, 1},   {-1, 0, 0},
+    {1, -1, 0},   {0, -1, 0},  {-1, -1, 0}, {1, 1, -1},  {0, 1, -1},
+    {-1, 1, -1},  {1, 0, -1},  {0, 0, -1},  {-1, 0, -1}, {1, -1, -1},
+    {0, -1, -1},  {-1, -1, -1}};
+static const int halfShellSize = 14;
+
+static inline uint32_t hashCell(uint64_t key, uint32_t mask) {
+  key *= 0x9E3779B97F4A7C15ull;
+  return (uint32_t)(key >> 32) & mask;
+}
+
+void findPairsUniformGrid(const SimulationState &state, StepArenas &arenas,
+                          std::vector<BodyPair> &pairs) {
+  pairs.clear();
+  uint32_t count = state.size();
+  if (count == 0) {
+    return;
+  }
+
+  // Cells as wide as the largest sphere, so overlapping boxes are always in
+  // neighbouring cells
+  float maxRadius = *std::max_element(state.radius.begin(), state.radius.end());
+  float inverseCell = 1.0f / (2.0f * maxRadius);
+  uint32_t tableSize = 1;
+  while (tableSize < 2 * count) {
+    tableSize <<= 1;
+  }
+  uint32_t mask = tableSize - 1;
+
+  // Counting sort of the bodies by hashed cell
+  LinearArena &arena = arenas.shared();
+  uint64_t *keys = arena.allocate<uint64_t>(count);
+  uint32_t *bucketStart = arena.allocate<uint32_t>(tableSize + 1);
+  uint32_t *bucketBodies = arena.allocate<uint32_t>(count);
+  memset(bucketStart, 0, (tableSize + 1) * sizeof(uint32_t));
+  for (uint32_t i = 0; i < count; ++i) {
+    keys[i] = cellKey((int32_t)std::floor(state.posX[i] * inverseCell),
+                      (int32_t)std::floor(state.posY[i] * inverseCell),
+                      (int32_t)std::floor(state.posZ[i] * inverseCell));
+    ++bucketStart[hashCell(keys[i], mask) + 1];
+  }
+  for (uint32_t b = 0; b < tableSize; ++b) {
+    bucketStart[b + 1] += bucketStart[b];
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    bucketBodies[bucketStart[hashCell(keys[i], mask)]++] = i;
+  }
+  // Filling advanced every start to the next bucket's, shift them back
+  for (uint32_t b = tableSize; b > 0; --b) {
+    bucketStart[b] = bucketStart[b - 1];
+  }
+  bucketStart[0] = 0;
+
+  // With everyone awake, half of the 26 neighbours is enough: every pair of
+  // different cells is seen from exactly one side. Once bodies sleep only
+  // the awake ones look around, through all 26, and a pair of two awake
+  // bodies is kept from its lower index.
+  uint32_t *queries = arena.allocate<uint32_t>(count);
+  uint32_t queryCount = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (state.awake[i]) {
+      queries[queryCount++] = i;
+    }
+  }
+  bool everyoneAwake = queryCount == count;
+  int shellSize = everyoneAwake ? halfShellSize : 27;
+
+  // Each pool thread collects pairs into its own arena, merged below
+  size_t threads = arenas.threadCount();
+  ArenaArray<BodyPair> *found = arena.allocate<ArenaArray<BodyPair>>(threads);
+  for (size_t t = 0; t < threads; ++t) {
+    new (&found[t]) ArenaArray<BodyPair>();
+  }
+  parallelFor(queryCount, 1024, [&](size_t begin, size_t end) {
+    size_t thread = parallelThreadIndex();
+    ArenaArray<BodyPair> &local = found[thread];
+    LinearArena &localArena = arenas.thread(thread);
+    for (size_t q = begin; q < end; ++q) {
+      uint32_t i = queries[q];
+      int32_t cx = (int32_t)std::floor(state.posX[i] * inverseCell);
+      int32_t cy = (int32_t)std::floor(state.posY[i] * inverseCell);
+      int32_t cz = (int32_t)std::floor(state.posZ[i] * inverseCell);
+
+      for (int n = 0; n < shellSize; ++n) {
+        const int *offset = fullShell[n];
+        // Buckets are shared by colliding cells, only take the bodies that
+        // really are in this one so no pair is reported twice
+        uint64_t key = cellKey(cx + offset[0], cy + offset[1], cz + offset[2]);
+        uint32_t bucket = hashCell(key, mask);
+        for (uint32_t k = bucketStart[bucket]; k < bucketStart[bucket + 1];
+             ++k) {
+          uint32_t j = bucketBodies[k];
+          bool seenHere = everyoneAwake ? n > 0 || j > i
+                                        : j != i && (!state.awake[j] || j > i);
+          if (keys[j] == key && seenHere && boxesOverlap(state, i, j)) {
+            local.push_back(localArena, makePair(i, j));
+          }
+        }
+      }
+    }
+  });
+
+  size_t total = 0;
+  for (size_t t = 0; t < threads; ++t) {
+    total += found[t].size;
+  }
+  // resize() after clear() would grow to an exact fit, and again every step
+  // the count creeps up
+  if (pairs.capacity() < total) {
+    pairs.reserve(std::max(total, 2 * pairs.capacity()));
+  }
+  pairs.resize(total);
+  BodyPair *out = pairs.data();
+  for (size_t t = 0; t < threads; ++t) {
+    std::copy(found[t].data, found[t].data + found[t].size, out);
+    out += found[t].size;
+  }
+  sortPairs(pairs);
+}
+
+void findPairs(BroadPhase broadPhase, const SimulationState &state,
+               StepArenas &arenas, std::vector<BodyPair> &pairs) {
+  PROFILE_SCOPE("findPairs");
+  switch (broadPhase) {
+  case BroadPhaseBruteForce:
+    findPairsBruteForce(state, pairs);
+    break;
+  case BroadPhaseSweepAndPrune:
+    findPairsSweepAndPrune(state, arenas, pairs);
+    break;
+  default:
+    findPairsUniformGrid(state, arenas, pairs);
+    break;
+  }
+}
@@ -0,0 +1,190 @@
+#include "checkpoint.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+// Layout: magic, version, body count, step count, gravity, ground height,
+// damping, per-body float arrays, awake flags, island ids, contact impulses, RNG state
+static const char checkpointMagic[4] = {'E', 'C', 'C', 'P'};
+static const uint32_t checkpointVersion = 6;
+
+// Every per-body array, in the order they are written
+static std::vector<float> SimulationState::*const bodyArrays[] = {
+    &SimulationState::posX,   &SimulationState::posY,
+    &SimulationState::posZ,   &SimulationState::velX,
+    &SimulationState::velY,   &SimulationState::velZ,
+    &SimulationState::radius, &SimulationState::rotation,
+    &SimulationState::sleepTimer};
+
+static void append(std::vector<unsigned char> &buffer, const void *data,
+                   size_t size) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+static bool take(const unsigned char *&cursor, const unsigned char *end,
+                 void *out, size_t size) {
+  if (static_cast<size_t>(end - cursor) < size) {
+    return false;
+  }
+  memcpy(out, cursor, size);
+  cursor += size;
+  return true;
+}
+
+void saveCheckpoint(const SimulationState &state,
+                    std::vector<unsigned char> &buffer) {
+  uint64_t bodyCount = state.size();
+  uint64_t stepCount = state.stepCount;
+
+  // The standard engines serialize their full state as text
+  std::ostringstream rngStream;
+  rngStream << state.rng;
+  std::string rngState = rngStream.str();
+  uint64_t rngSize = rngState.size();
+
+  // The cache goes out as its entries in pair order, the table layout
+  // depends on its history
+  std::vector<ContactImpulse> impulses;
+  state.contactCache.entries(impulses);
+
+  buffer.clear();
+  size_t bodyBytes =
+      sizeof(float) * std::size(bodyArrays) + 1 + sizeof(uint32_t);
+  buffer.reserve(52 + bodyCount * bodyBytes +
+                 impulses.size() * sizeof(ContactImpulse) + rngSize);
+  append(buffer, checkpointMagic, sizeof(checkpointMagic));
+  append(buffer, &checkpointVersion, sizeof(checkpointVersion));
+  append(buffer, &bodyCount, sizeof(bodyCount));
+  append(buffer, &stepCount, sizeof(stepCount));
+  append(buffer, &state.gravity, sizeof(state.gravity));
+  append(buffer, &state.groundY, sizeof(state.groundY));
+  append(buffer, &state.damping, sizeof(state.damping));
+  for (auto member : bodyArrays) {
+    const std::vector<float> &array = state.*member;
+    append(buffer, array.data(), bodyCount * sizeof(float));
+  }
+  append(buffer, state.awake.data(), bodyCount);
+  append(buffer, state.island.data(), bodyCount * sizeof(uint32_t));
+  uint64_t impulseCount = impulses.size();
+  append(buffer, &impulseCount, sizeof(impulseCount));
+  append(buffer, impulses.data(), impulseCount * sizeof(ContactImpulse));
+  append(buffer, &rngSize, sizeof(rngSize));
+  append(buffer, rngState.data(), rngSize);
+}
+
+bool restoreCheckpoint(SimulationState &state, const unsigned char *data,
+                       size_t size) {
+  const unsigned char *cursor = data;
+  const unsigned char *end = data + size;
+
+  char magic[4];
+  uint32_t version;
+  uint64_t bodyCount, stepCount;
+  float gravity, groundY, damping;
+  if (!take(cursor, end, magic, sizeof(magic)) ||
+      memcmp(magic, checkpointMagic, sizeof(magic)) != 0 ||
+      !take(cursor, end, &version, sizeof(version)) ||
+      version != checkpointVersion ||
+      !take(cursor, end, &bodyCount, sizeof(bodyCount)) ||
+      !take(cursor, end, &stepCount, sizeof(stepCount)) ||
+      !take(cursor, end, &gravity, sizeof(gravity)) ||
+      !take(cursor, end, &groundY, sizeof(groundY)) ||
+      !take(cursor, end, &damping, sizeof(damping)) ||
+      !validDamping(damping)) {
+    std::cerr << "Error: Not a valid checkpoint" << std::endl;
+    return false;
+  }
+  if (bodyCount > static_cast<uint64_t>(end - cursor) / sizeof(float)) {
+    std::cerr << "Error: Truncated checkpoint" << std::endl;
+    return false;
+  }
+
+  // Decode into a scratch state so a bad checkpoint leaves the old one intact
+  SimulationState restored;
+  for (auto member : bodyArrays) {
+    std::vector<float> &array = restored.*member;
+    array.resize(bodyCount);
+    if (!take(cursor, end, array.data(), bodyCount * sizeof(float))) {
+      std::cerr << "Error: Truncated checkpoint" << std::endl;
+      return false;
+    }
+  }
+  restored.awake.resize(bodyCount);
+  restored.island.resize(bodyCount);
+  if (!take(cursor, end, restored.awake.data(), bodyCount) ||
+      !take(cursor, end, restored.island.data(),
+            bodyCount * sizeof(uint32_t))) {
+    std::cerr << "Error: Truncated checkpoint" << std::endl;
+    return false;
+  }
+  // Held to the scene loaders' rule, a bad radius would put Inf and NaN in
+  // the state through the mass and the rolling angle
+  for (size_t i = 0; i < bodyCount; ++i) {
+    if (!validBody(restored, i) || restored.island[i] >= bodyCount) {
+      std::cerr << "Error: Invalid body " << i << " in checkpoint"
+                << std::endl;
+      return false;
+    }
+  }
+
+  uint64_t impulseCount;
+  if (!take(cursor, end, &impulseCount, sizeof(impulseCount)) ||
+      impulseCount > static_cast<uint64_t>(end - cursor) /
+                         sizeof(ContactImpulse)) {
+    std::cerr << "Error: Truncated checkpoint" << std::endl;
+    return false;
+  }
+  std::vector<ContactImpulse> impulses(impulseCount);
+  take(cursor, end, impulses.data(), impulseCount * sizeof(ContactImpulse));
+  restored.contactCache.assign(impulses);
+
+  uint64_t rngSize;
+  if (!take(cursor, end, &rngSize, sizeof(rngSize)) ||
+      rngSize > static_cast<uint64_t>(end - cursor)) {
+    std::cerr << "Error: Truncated checkpoint" << std::endl;
+    return false;
+  }
+  std::istringstream rngStream(
+      std::string(reinterpret_cast<const char *>(cursor), rngSize));
+  rngStream >> restored.rng;
+  if (rngStream.fail()) {
+    std::cerr << "Error: Invalid RNG state in checkpoint" << std::endl;
+    return false;
+  }
+
+  restored.stepCount = stepCount;
+  restored.gravity = gravity;
+  restored.groundY = groundY;
+  restored.damping = damping;
+  state = std::move(restored);
+  return true;
+}
+
+bool saveCheckpointFile(const SimulationState &state, const char *path) {
+  std::vector<unsigned char> buffer;
+  saveCheckpoint(state, buffer);
+
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+  return file.good();
+}
+
+bool loadCheckpointFile(SimulationState &state, const char *path) {
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  std::vector<unsigned char> buffer((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+  return restoreCheckpoint(state, buffer.data(), buffer.size());
+}
@@ -0,0 +1,117 @@
+#include "contactcache.h"
+#include <algorithm>
+
+static inline uint64_t pairKey(uint32_t a, uint32_t b) {
+  return (uint64_t(a) << 32) | b;
+}
+
+static inline size_t hashKey(uint64_t key, size_t mask) {
+  key *= 0x9E3779B97F4A7C15ull;
+  return size_t(key >> 32) & mask;
+}
+
+void ContactCache::beginStep(size_t expected) {
+  ++generation;
+  // Probe chains only end at never used slots, so retired entries count
+  // against the load until a rebuild drops them
+  if (2 * (usedSlots + expected) > slots.size()) {
+    rebuild(expected);
+  }
+}
+
+void ContactCache::rebuild(size_t expected) {
+  // Survivors are set aside in retained storage and the table is cleared
+  // in place, so a steady-state rebuild never touches the heap
+  survivors.clear();
+  for (const Slot &slot : slots) {
+    if (slot.generation + 1 == generation) {
+      survivors.push_back(slot);
+    }
+  }
+
+  // Room for what survives plus this step's inserts at a quarter load, so
+  // the next rebuild is many steps away
+  size_t capacity = std::max(slots.size(), size_t(16));
+  while (capacity < 4 * (survivors.size() + expected)) {
+    capacity *= 2;
+  }
+  slots.assign(capacity, Slot{0, 0.0f, 0});
+  usedSlots = survivors.size();
+
+  size_t mask = capacity - 1;
+  for (const Slot &slot : survivors) {
+    size_t i = hashKey(slot.key, mask);
+    while (slots[i].generation != 0) {
+      i = (i + 1) & mask;
+    }
+    slots[i] = slot;
+  }
+}
+
+float ContactCache::find(uint32_t a, uint32_t b) const {
+  if (slots.empty()) {
+    return 0.0f;
+  }
+  uint64_t key = pairKey(a, b);
+  size_t mask = slots.size() - 1;
+  for (size_t i = hashKey(key, mask); slots[i].generation != 0;
+       i = (i + 1) & mask) {
+    if (slots[i].key == key) {
+      return slots[i].generation + 1 == generation ? slots[i].impulse : 0.0f;
+    }
+  }
+  return 0.0f;
+}
+
+void ContactCache::store(uint32_t a, uint32_t b, float impulse) {
+  uint64_t key = pairKey(a, b);
+  size_t mask = slots.size() - 1;
+  // A key is in its chain at most once, look at the whole chain before
+  // taking the first retired slot
+  size_t reuse = SIZE_MAX;
+  size_t i = hashKey(key, mask);
+  for (; slots[i].generation != 0; i = (i + 1) & mask) {
+    if (slots[i].key == key) {
+      slots[i].impulse = impulse;
+      slots[i].generation = generation;
+      return;
+    }
+    if (reuse == SIZE_MAX && slots[i].generation + 1 < generation) {
+      reuse = i;
+    }
+  }
+  if (reuse == SIZE_MAX) {
+    reuse = i;
+    ++usedSlots;
+  }
+  slots[reuse] = Slot{key, impulse, generation};
+}
+
+void ContactCache::clear() {
+  slots.clear();
+  survivors.clear();
+  usedSlots = 0;
+  generation = 1;
+}
+
+void ContactCache::entries(std::vector<ContactImpulse> &out) const {
+  out.clear();
+  for (const Slot &slot : slots) {
+    if (slot.generation == generation) {
+      out.push_back({uint32_t(slot.key >> 32), uint32_t(slot.key),
+                     slot.impulse});
+    }
+  }
+  std::sort(out.begin(), out.end(),
+            [](const ContactImpulse &left, const ContactImpulse &right) {
+              return left.a != right.a ? left.a < right.a : left.b < right.b;
+            });
+}
+
+void ContactCache::assign(const std::vector<ContactImpulse> &in) {
+  clear();
+  rebuild(in.size());
+  for (const ContactImpulse &entry : in) {
+    store(entry.a, entry.b, entry.impulse);
+  }
+}
@@ -7,6 +7,8 @@ extern GLFWwindow* window; // The "extern" keyword here is to access the variabl
 #include <glm/gtc/matrix_transform.hpp>
 using namespace glm;
 
+#include <cstdio>
+
 #include "controls.h"
 
 glm::mat4 ViewMatrix;
@@ -102,3 +104,66 @@ void computeMatricesFromInputs(){
 	// For the next frame, the "last time" will be "now"
 	lastTime = currentTime;
 }
+
+bool loadCameraPath(const char *path, std::vector<CameraKey> &keys) {
+	FILE *file = fopen(path, "r");
+	if (!file) {
+		printf("%s could not be opened\n", path);
+		return false;
+	}
+
+	keys.clear();
+	CameraKey key;
+	while (fscanf(file, "%f %f %f %f %f %f %f", &key.time, &key.position.x,
+	              &key.position.y, &key.position.z, &key.target.x,
+	              &key.target.y, &key.target.z) == 7) {
+		keys.push_back(key);
+	}
+	fclose(file);
+
+	if (keys.empty()) {
+		printf("%s contains no camera keyframes\n", path);
+		return false;
+	}
+	return true;
+}
+
+void defaultCameraPath(std::vector<CameraKey> &keys){
+	keys.clear();
+	const int steps = 16;
+	for (int i = 0; i <= steps; i++) {
+		float angle = 2.0f * 3.14159265f * i / steps;
+		CameraKey key;
+		key.time = 1.0f * i;
+		key.position = glm::vec3(40.0f * sin(angle), 10.0f, 40.0f * cos(angle));
+		key.target = glm::vec3(0, -3, 0);
+		keys.push_back(key);
+	}
+}
+
+void computeMatricesFromPath(const std::vector<CameraKey> &keys, float time,
+                             float aspectRatio){
+	if (keys.empty()) {
+		return;
+	}
+
+	// Loop the path and find the keyframes around the current time
+	float duration = keys.back().time;
+	if (duration > 0.0f) {
+		time = fmod(time, duration);
+	}
+	size_t next = 0;
+	while (next < keys.size() && keys[next].time <= time) {
+		next++;
+	}
+	const CameraKey &a = keys[next == 0 ? 0 : next - 1];
+	const CameraKey &b = keys[next < keys.size() ? next : keys.size() - 1];
+	float span = b.time - a.time;
+	float t = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+	glm::vec3 eye = a.position + (b.position - a.position) * t;
+	glm::vec3 target = a.target + (b.target - a.target) * t;
+
+	ProjectionMatrix = glm::perspective(glm::radians(initialFoV), aspectRatio, 0.1f, 100.0f);
+	ViewMatrix       = glm::lookAt(eye, target, glm::vec3(0, 1, 0));
+}
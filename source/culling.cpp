@@ -0,0 +1,26 @@
+#include "culling.h"
+#include <cmath>
+
+void extractFrustum(const glm::mat4 &viewProjection, Frustum &frustum) {
+  // Rows of the matrix, glm stores columns
+  glm::vec4 row[4];
+  for (int i = 0; i < 4; ++i) {
+    row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i],
+                       viewProjection[2][i], viewProjection[3][i]);
+  }
+
+  frustum.planes[0] = row[3] + row[0]; // Left
+  frustum.planes[1] = row[3] - row[0]; // Right
+  frustum.planes[2] = row[3] + row[1]; // Bottom
+  frustum.planes[3] = row[3] - row[1]; // Top
+  frustum.planes[4] = row[3] + row[2]; // Near
+  frustum.planes[5] = row[3] - row[2]; // Far
+
+  // Normalize so the plane distance is in world units
+  for (int i = 0; i < 6; ++i) {
+    glm::vec4 &plane = frustum.planes[i];
+    float length =
+        std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    plane = plane * (1.0f / length);
+  }
+}
@@ -0,0 +1,247 @@
+#include "dds.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// DDS_HEADER after the "DDS " magic, every field a little-endian uint32
+struct DDSHeader {
+  uint32_t size;
+  uint32_t flags;
+  uint32_t height;
+  uint32_t width;
+  uint32_t pitchOrLinearSize;
+  uint32_t depth;
+  uint32_t mipMapCount;
+  uint32_t reserved1[11];
+  uint32_t formatSize;
+  uint32_t formatFlags;
+  uint32_t fourCC;
+  uint32_t rgbBitCount;
+  uint32_t masks[4];
+  uint32_t caps;
+  uint32_t caps2;
+  uint32_t caps3;
+  uint32_t caps4;
+  uint32_t reserved2;
+};
+
+// Extended header used for formats without a FourCC such as BC7
+struct DDSHeaderDX10 {
+  uint32_t dxgiFormat;
+  uint32_t resourceDimension;
+  uint32_t miscFlag;
+  uint32_t arraySize;
+  uint32_t miscFlags2;
+};
+
+static const char ddsMagic[4] = {'D', 'D', 'S', ' '};
+static const uint32_t flagCaps = 0x1, flagHeight = 0x2, flagWidth = 0x4,
+                      flagPixelFormat = 0x1000, flagMipMapCount = 0x20000,
+                      flagLinearSize = 0x80000;
+static const uint32_t formatFourCC = 0x4;
+static const uint32_t capsComplex = 0x8, capsTexture = 0x1000,
+                      capsMipMap = 0x400000;
+static const uint32_t caps2CubeMap = 0x200, caps2Volume = 0x200000;
+static const uint32_t dxgiBC1 = 71, dxgiBC1Srgb = 72, dxgiBC7 = 98,
+                      dxgiBC7Srgb = 99;
+static const uint32_t dimensionTexture2D = 3;
+static const int maxDimension = 1 << 15;
+
+static uint32_t fourCC(const char code[5]) {
+  return uint32_t(uint8_t(code[0])) | uint32_t(uint8_t(code[1])) << 8 |
+         uint32_t(uint8_t(code[2])) << 16 | uint32_t(uint8_t(code[3])) << 24;
+}
+
+size_t blockBytes(CompressedFormat format) {
+  return format == FormatBC1 ? 8 : 16;
+}
+
+static size_t compressedSize(CompressedFormat format, int width, int height) {
+  return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+MappedDDS::MappedDDS()
+    : mapping(nullptr), mappingSize(0), blockFormat(FormatBC1), baseWidth(0),
+      baseHeight(0) {}
+
+MappedDDS::~MappedDDS() { close(); }
+
+bool MappedDDS::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) <
+          sizeof(ddsMagic) + sizeof(DDSHeader)) {
+    std::cerr << "Error: " << path << " is not a DDS file" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  size_t size = info.st_size;
+  void *data =
+      mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Error: Cannot map " << path << std::endl;
+    return false;
+  }
+
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  DDSHeader header;
+  memcpy(&header, bytes + sizeof(ddsMagic), sizeof(header));
+  size_t offset = sizeof(ddsMagic) + sizeof(header);
+
+  const char *problem = nullptr;
+  CompressedFormat format = FormatBC1;
+  if (memcmp(bytes, ddsMagic, sizeof(ddsMagic)) != 0 ||
+      header.size != sizeof(DDSHeader)) {
+    problem = "is not a DDS file";
+  } else if (!(header.formatFlags & formatFourCC) ||
+             (header.caps2 & (caps2CubeMap | caps2Volume))) {
+    problem = "is not a compressed 2D texture";
+  } else if (header.fourCC == fourCC("DXT1")) {
+    format = FormatBC1;
+  } else if (header.fourCC == fourCC("DX10") &&
+             size >= offset + sizeof(DDSHeaderDX10)) {
+    DDSHeaderDX10 extended;
+    memcpy(&extended, bytes + offset, sizeof(extended));
+    offset += sizeof(extended);
+    if (extended.resourceDimension != dimensionTexture2D ||
+        extended.arraySize > 1) {
+      problem = "is not a compressed 2D texture";
+    } else if (extended.dxgiFormat == dxgiBC1 ||
+               extended.dxgiFormat == dxgiBC1Srgb) {
+      format = FormatBC1;
+    } else if (extended.dxgiFormat == dxgiBC7 ||
+               extended.dxgiFormat == dxgiBC7Srgb) {
+      format = FormatBC7;
+    } else {
+      problem = "has an unsupported DXGI format";
+    }
+  } else {
+    problem = "is not BC1 or BC7 compressed";
+  }
+
+  int width = (int)std::min<uint32_t>(header.width, maxDimension + 1);
+  int height = (int)std::min<uint32_t>(header.height, maxDimension + 1);
+  if (!problem && (width <= 0 || width > maxDimension || height <= 0 ||
+                   height > maxDimension)) {
+    problem = "has invalid DDS dimensions";
+  }
+
+  // A missing count means a single level; never more than the full chain
+  int count = std::max<uint32_t>(header.mipMapCount, 1);
+  std::vector<Level> chain;
+  for (int level = 0; !problem && level < count; ++level) {
+    int w = std::max(1, width >> level);
+    int h = std::max(1, height >> level);
+    size_t bytesInLevel = compressedSize(format, w, h);
+    if (size - offset < bytesInLevel) {
+      problem = "is truncated";
+      break;
+    }
+    chain.push_back({offset, bytesInLevel});
+    offset += bytesInLevel;
+    if (w == 1 && h == 1) {
+      break;
+    }
+  }
+  if (problem) {
+    std::cerr << "Error: " << path << " " << problem << std::endl;
+    munmap(data, size);
+    return false;
+  }
+
+  mapping = data;
+  mappingSize = size;
+  blockFormat = format;
+  baseWidth = width;
+  baseHeight = height;
+  levels.swap(chain);
+  return true;
+}
+
+void MappedDDS::close() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+  baseWidth = 0;
+  baseHeight = 0;
+  levels.clear();
+}
+
+int MappedDDS::levelWidth(int level) const {
+  return std::max(1, baseWidth >> level);
+}
+
+int MappedDDS::levelHeight(int level) const {
+  return std::max(1, baseHeight >> level);
+}
+
+const unsigned char *MappedDDS::levelData(int level) const {
+  return static_cast<const unsigned char *>(mapping) + levels[level].offset;
+}
+
+size_t MappedDDS::levelSize(int level) const { return levels[level].size; }
+
+bool writeDDS(const char *path, CompressedFormat format, int width, int height,
+              const std::vector<std::vector<unsigned char>> &levels) {
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  DDSHeader header;
+  memset(&header, 0, sizeof(header));
+  header.size = sizeof(header);
+  header.flags = flagCaps | flagHeight | flagWidth | flagPixelFormat |
+                 flagMipMapCount | flagLinearSize;
+  header.height = height;
+  header.width = width;
+  header.pitchOrLinearSize = compressedSize(format, width, height);
+  header.mipMapCount = levels.size();
+  header.formatSize = 32;
+  header.formatFlags = formatFourCC;
+  header.fourCC = fourCC(format == FormatBC1 ? "DXT1" : "DX10");
+  header.caps = capsTexture;
+  if (levels.size() > 1) {
+    header.caps |= capsComplex | capsMipMap;
+  }
+  file.write(ddsMagic, sizeof(ddsMagic));
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  if (format == FormatBC7) {
+    DDSHeaderDX10 extended = {dxgiBC7, dimensionTexture2D, 0, 1, 0};
+    file.write(reinterpret_cast<const char *>(&extended), sizeof(extended));
+  }
+  for (const std::vector<unsigned char> &level : levels) {
+    file.write(reinterpret_cast<const char *>(level.data()), level.size());
+  }
+  return file.good();
+}
+
+std::string compressedPath(const char *path) {
+  std::string result(path);
+  size_t dot = result.find_last_of('.');
+  size_t slash = result.find_last_of('/');
+  if (dot != std::string::npos &&
+      (slash == std::string::npos || dot > slash)) {
+    result.erase(dot);
+  }
+  return result + ".dds";
+}
@@ -0,0 +1,142 @@
+#include "energy.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Bodies per chunk, fixed so the summation order never depends on threads
+static const size_t chunkSize = 4096;
+
+namespace {
+
+struct KahanSum {
+  double sum = 0.0;
+  double compensation = 0.0;
+
+  void add(double value) {
+    double corrected = value - compensation;
+    double next = sum + corrected;
+    compensation = (next - sum) - corrected;
+    sum = next;
+  }
+};
+
+void sumChunk(const SimulationState &state, size_t begin, size_t end,
+              ConservationTotals &totals) {
+  KahanSum kinetic, potential, momentumX, momentumY, momentumZ, scale;
+  for (size_t i = begin; i < end; ++i) {
+    double mass = bodyMass(state.radius[i]);
+    double vx = state.velX[i], vy = state.velY[i], vz = state.velZ[i];
+    double speedSquared = vx * vx + vy * vy + vz * vz;
+    kinetic.add(0.5 * mass * speedSquared);
+    potential.add(mass * state.gravity * (state.posY[i] - state.groundY));
+    momentumX.add(mass * vx);
+    momentumY.add(mass * vy);
+    momentumZ.add(mass * vz);
+    scale.add(mass * std::sqrt(speedSquared));
+  }
+  totals.kinetic = kinetic.sum;
+  totals.potential = potential.sum;
+  totals.momentum[0] = momentumX.sum;
+  totals.momentum[1] = momentumY.sum;
+  totals.momentum[2] = momentumZ.sum;
+  totals.momentumScale = scale.sum;
+}
+
+void addTotals(ConservationTotals &into, const ConservationTotals &other) {
+  into.kinetic += other.kinetic;
+  into.potential += other.potential;
+  for (int axis = 0; axis < 3; ++axis) {
+    into.momentum[axis] += other.momentum[axis];
+  }
+  into.momentumScale += other.momentumScale;
+}
+
+// Pairwise sum of the chunk results, error grows with log(chunks)
+ConservationTotals sumPairwise(const ConservationTotals *partials,
+                               size_t count) {
+  if (count == 1) {
+    return partials[0];
+  }
+  size_t half = count / 2;
+  ConservationTotals totals = sumPairwise(partials, half);
+  addTotals(totals, sumPairwise(partials + half, count - half));
+  return totals;
+}
+
+} // namespace
+
+void computeConservationTotals(const SimulationState &state,
+                               std::vector<ConservationTotals> &partials,
+                               ConservationTotals &totals) {
+  PROFILE_FUNCTION();
+  size_t count = state.size();
+  size_t chunks = (count + chunkSize - 1) / chunkSize;
+  if (chunks == 0) {
+    totals = ConservationTotals();
+    return;
+  }
+  partials.resize(chunks);
+  parallelFor(chunks, 1, [&](size_t begin, size_t end) {
+    for (size_t chunk = begin; chunk < end; ++chunk) {
+      size_t first = chunk * chunkSize;
+      size_t last = first + chunkSize < count ? first + chunkSize : count;
+      sumChunk(state, first, last, partials[chunk]);
+    }
+  });
+  totals = sumPairwise(partials.data(), chunks);
+}
+
+EnergyMonitor::EnergyMonitor(uint64_t interval, double threshold)
+    : interval(interval > 0 ? interval : 1), threshold(threshold),
+      reference(), latest(), sleptKinetic(0.0), sleptMomentum(),
+      dissipatedEnergy(0.0),
+      energyDriftValue(0.0), momentumDriftValue(0.0), driftFlag(false) {}
+
+void EnergyMonitor::reset(const SimulationState &state) {
+  computeConservationTotals(state, partials, reference);
+  latest = reference;
+  sleptKinetic = state.sleptKinetic;
+  std::copy(state.sleptMomentum, state.sleptMomentum + 3, sleptMomentum);
+  dissipatedEnergy = state.dissipatedEnergy;
+  energyDriftValue = 0.0;
+  momentumDriftValue = 0.0;
+  driftFlag = false;
+}
+
+bool EnergyMonitor::update(const SimulationState &state, float deltaTime) {
+  if (state.stepCount % interval != 0) {
+    return false;
+  }
+  computeConservationTotals(state, partials, latest);
+  latest.kinetic += state.sleptKinetic - sleptKinetic;
+  latest.kinetic += state.dissipatedEnergy - dissipatedEnergy;
+  for (int axis = 0; axis < 3; ++axis) {
+    latest.momentum[axis] += state.sleptMomentum[axis] - sleptMomentum[axis];
+  }
+
+  // What the integrator conserves, see the header
+  double shift = 0.5 * state.gravity * deltaTime;
+  double referenceEnergy = reference.energy() - shift * reference.momentum[1];
+  double latestEnergy = latest.energy() - shift * latest.momentum[1];
+  energyDriftValue =
+      referenceEnergy != 0.0
+          ? (latestEnergy - referenceEnergy) / std::fabs(referenceEnergy)
+          : 0.0;
+  double dx = latest.momentum[0] - reference.momentum[0];
+  double dy = latest.momentum[1] - reference.momentum[1];
+  double dz = latest.momentum[2] - reference.momentum[2];
+  momentumDriftValue =
+      reference.momentumScale != 0.0
+          ? std::sqrt(dx * dx + dy * dy + dz * dz) / reference.momentumScale
+          : 0.0;
+
+  if (!driftFlag && std::fabs(energyDriftValue) > threshold) {
+    driftFlag = true;
+    std::cerr << "Warning: energy drifted by " << energyDriftValue * 100.0
+              << "% at step " << state.stepCount << std::endl;
+  }
+  return true;
+}
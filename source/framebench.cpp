@@ -0,0 +1,124 @@
+#include "framebench.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+const char *frameStageName(FrameStage stage) {
+  static const char *names[FrameStageCount] = {"physics", "culling", "upload",
+                                               "draw",    "imgui",   "swap"};
+  return names[stage];
+}
+
+void StageTimer::start() { last = std::chrono::steady_clock::now(); }
+
+double StageTimer::lap() {
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double elapsed =
+      std::chrono::duration<double, std::milli>(now - last).count();
+  last = now;
+  return elapsed;
+}
+
+FrameBenchmark::FrameBenchmark(size_t frames, size_t warmupFrames)
+    : frames(frames), warmupFrames(warmupFrames), frameCount(0),
+      gpuFrameCount(0) {
+  samples.reserve(frames);
+  gpuSamples.reserve(frames);
+}
+
+void FrameBenchmark::addFrame(const FrameSample &sample) {
+  if (frameCount++ >= warmupFrames && samples.size() < frames) {
+    samples.push_back(sample);
+  }
+}
+
+void FrameBenchmark::addGpuFrame(double milliseconds) {
+  if (gpuFrameCount++ >= warmupFrames && gpuSamples.size() < frames) {
+    gpuSamples.push_back(milliseconds);
+  }
+}
+
+struct Percentiles {
+  double p50, p90, p99, max, mean;
+};
+
+static Percentiles percentiles(std::vector<double> values) {
+  Percentiles result = {0, 0, 0, 0, 0};
+  if (values.empty()) {
+    return result;
+  }
+  std::sort(values.begin(), values.end());
+  size_t last = values.size() - 1;
+  result.p50 = values[last * 50 / 100];
+  result.p90 = values[last * 90 / 100];
+  result.p99 = values[last * 99 / 100];
+  result.max = values[last];
+  for (double value : values) {
+    result.mean += value;
+  }
+  result.mean /= values.size();
+  return result;
+}
+
+// Per-stage series plus the CPU and GPU frame totals
+static void collectSeries(const std::vector<FrameSample> &samples,
+                          const std::vector<double> &gpuSamples,
+                          std::vector<const char *> &names,
+                          std::vector<Percentiles> &stats) {
+  std::vector<double> values(samples.size());
+  for (int stage = 0; stage < FrameStageCount; ++stage) {
+    for (size_t i = 0; i < samples.size(); ++i) {
+      values[i] = samples[i].stages[stage];
+    }
+    names.push_back(frameStageName(static_cast<FrameStage>(stage)));
+    stats.push_back(percentiles(values));
+  }
+  for (size_t i = 0; i < samples.size(); ++i) {
+    values[i] = samples[i].cpuFrame;
+  }
+  names.push_back("cpu_frame");
+  stats.push_back(percentiles(values));
+  names.push_back("gpu_frame");
+  stats.push_back(percentiles(gpuSamples));
+}
+
+void FrameBenchmark::printSummary() const {
+  std::vector<const char *> names;
+  std::vector<Percentiles> stats;
+  collectSeries(samples, gpuSamples, names, stats);
+
+  printf("%zu frames (%zu GPU timed), milliseconds\n", samples.size(),
+         gpuSamples.size());
+  printf("%-10s %9s %9s %9s %9s %9s\n", "stage", "mean", "p50", "p90", "p99",
+         "max");
+  for (size_t i = 0; i < names.size(); ++i) {
+    printf("%-10s %9.3f %9.3f %9.3f %9.3f %9.3f\n", names[i], stats[i].mean,
+           stats[i].p50, stats[i].p90, stats[i].p99, stats[i].max);
+  }
+}
+
+bool FrameBenchmark::writeReport(const char *path,
+                                 const char *scenePath) const {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  std::vector<const char *> names;
+  std::vector<Percentiles> stats;
+  collectSeries(samples, gpuSamples, names, stats);
+
+  fprintf(file, "{\n  \"scene\": \"%s\",\n  \"frames\": %zu,\n", scenePath,
+          samples.size());
+  fprintf(file, "  \"gpu_frames\": %zu,\n  \"stages_ms\": {", gpuSamples.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    fprintf(file,
+            "%s\n    \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+            "\"p99\": %.4f, \"max\": %.4f}",
+            i == 0 ? "" : ",", names[i], stats[i].mean, stats[i].p50,
+            stats[i].p90, stats[i].p99, stats[i].max);
+  }
+  fprintf(file, "\n  }\n}\n");
+  return fclose(file) == 0;
+}
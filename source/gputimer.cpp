@@ -0,0 +1,150 @@
+#include "gputimer.h"
+#include "imgui.h"
+#include "profiler.h"
+
+// Frames between clock resynchronisations
+static const int syncInterval = 256;
+// Weight of the newest frame in the overlay averages
+static const double smoothing = 0.1;
+
+GpuTimer::GpuTimer()
+    : writeSlot(0), readSlot(0), recording(false), depth(0), resolvedCount(0),
+      resolvedFrame(0.0), smoothedCount(0), smoothedFrame(0.0),
+      clockOffset(0), framesSinceSync(0), profileTrack(nullptr) {
+  for (int slot = 0; slot < framesInFlight; ++slot) {
+    glGenQueries(2 * maxZones, slots[slot].queries);
+    slots[slot].zoneCount = 0;
+    slots[slot].lastQuery = 0;
+    slots[slot].pending = false;
+  }
+  syncClocks();
+}
+
+GpuTimer::~GpuTimer() {
+  for (int slot = 0; slot < framesInFlight; ++slot) {
+    glDeleteQueries(2 * maxZones, slots[slot].queries);
+  }
+}
+
+void GpuTimer::syncClocks() {
+#ifdef ENABLE_PROFILER
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  clockOffset = gpuNow - (int64_t)profilerElapsedNs();
+#endif
+  framesSinceSync = 0;
+}
+
+void GpuTimer::beginFrame() {
+  FrameSlot &slot = slots[writeSlot % framesInFlight];
+  // Every slot is still in flight, skip timing this frame rather than stall
+  recording = !slot.pending;
+  slot.zoneCount = 0;
+  depth = 0;
+}
+
+void GpuTimer::beginZone(const char *name) {
+  int zone = -1;
+  FrameSlot &slot = slots[writeSlot % framesInFlight];
+  if (recording && slot.zoneCount < maxZones) {
+    zone = slot.zoneCount++;
+    slot.names[zone] = name;
+    glQueryCounter(slot.queries[2 * zone], GL_TIMESTAMP);
+  }
+  if (depth < maxDepth) {
+    openZones[depth] = zone;
+  }
+  ++depth;
+}
+
+void GpuTimer::endZone() {
+  if (depth == 0) {
+    return;
+  }
+  --depth;
+  if (depth >= maxDepth || openZones[depth] < 0) {
+    return;
+  }
+  FrameSlot &slot = slots[writeSlot % framesInFlight];
+  slot.lastQuery = slot.queries[2 * openZones[depth] + 1];
+  glQueryCounter(slot.lastQuery, GL_TIMESTAMP);
+}
+
+void GpuTimer::endFrame() {
+  FrameSlot &slot = slots[writeSlot % framesInFlight];
+  if (recording && slot.zoneCount > 0) {
+    slot.pending = true;
+    ++writeSlot;
+  }
+  recording = false;
+  if (++framesSinceSync >= syncInterval) {
+    syncClocks();
+  }
+}
+
+bool GpuTimer::resolveFrame() {
+  FrameSlot &slot = slots[readSlot % framesInFlight];
+  if (!slot.pending) {
+    return false;
+  }
+  GLint available = 0;
+  glGetQueryObjectiv(slot.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return false;
+  }
+
+  // Timestamps land in order, so every earlier query is available too
+  GLuint64 first = ~(GLuint64)0;
+  GLuint64 last = 0;
+  resolvedCount = slot.zoneCount;
+  for (int zone = 0; zone < slot.zoneCount; ++zone) {
+    GLuint64 start = 0, end = 0;
+    glGetQueryObjectui64v(slot.queries[2 * zone], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(slot.queries[2 * zone + 1], GL_QUERY_RESULT, &end);
+    end = end > start ? end : start;
+    first = start < first ? start : first;
+    last = end > last ? end : last;
+    resolvedNames[zone] = slot.names[zone];
+    resolvedTimes[zone] = (end - start) * 1e-6;
+#ifdef ENABLE_PROFILER
+    if (!profileTrack) {
+      profileTrack = profilerTrack("GPU");
+    }
+    profilerRecordTrack(profileTrack, slot.names[zone], start - clockOffset,
+                        end - clockOffset);
+#endif
+  }
+  resolvedFrame = (last - first) * 1e-6;
+  slot.pending = false;
+  ++readSlot;
+
+  for (int zone = 0; zone < resolvedCount; ++zone) {
+    int match = 0;
+    while (match < smoothedCount &&
+           smoothedNames[match] != resolvedNames[zone]) {
+      ++match;
+    }
+    if (match == smoothedCount) {
+      if (smoothedCount == maxZones) {
+        continue;
+      }
+      ++smoothedCount;
+      smoothedNames[match] = resolvedNames[zone];
+      smoothedTimes[match] = resolvedTimes[zone];
+    }
+    smoothedTimes[match] +=
+        smoothing * (resolvedTimes[zone] - smoothedTimes[match]);
+  }
+  smoothedFrame += smoothing * (resolvedFrame - smoothedFrame);
+  return true;
+}
+
+void GpuTimer::drawOverlay() {
+  ImGui::Begin("GPU Timings");
+  ImGui::Text("Frame      %7.3f ms", smoothedFrame);
+  ImGui::Separator();
+  for (int zone = 0; zone < smoothedCount; ++zone) {
+    ImGui::Text("%-10s %7.3f ms", smoothedNames[zone], smoothedTimes[zone]);
+  }
+  ImGui::End();
+}
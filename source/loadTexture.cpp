@@ -1,75 +1,35 @@
 #include "loadTexture.h"
+#include "texcompress.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unistd.h>
 
-GLuint loadBMP_custom(const char *imagepath) {
-
-  printf("Reading image %s\n", imagepath);
-
-  // Data read from the header of the BMP file
-  unsigned char header[54];
-  unsigned int dataPos;
-  unsigned int imageSize;
-  unsigned int width, height;
-  // Actual RGB data
-  unsigned char *data;
-
-  // Open the file
-  FILE *file = fopen(imagepath, "rb");
-  if (!file) {
-    printf("%s could not be opened. Are you in the right directory ? Don't "
-           "forget to read the FAQ !\n",
-           imagepath);
-    getchar();
-    return 0;
-  }
-
-  // Read the header, i.e. the 54 first bytes
-
-  // If less than 54 bytes are read, problem
-  if (fread(header, 1, 54, file) != 54) {
-    printf("Not a correct BMP file\n");
-    fclose(file);
-    return 0;
+void uploadBMP(const MappedBMP &image) {
+  // BMP rows are padded to 4 bytes, exactly GL's default unpack alignment
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (!image.topDown()) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0,
+                 GL_BGR, GL_UNSIGNED_BYTE, image.bottomRow());
+    return;
   }
-  // A BMP files always begins with "BM"
-  if (header[0] != 'B' || header[1] != 'M') {
-    printf("Not a correct BMP file\n");
-    fclose(file);
-    return 0;
-  }
-  // Make sure this is a 24bpp file
-  if (*(int *)&(header[0x1E]) != 0) {
-    printf("Not a correct BMP file\n");
-    fclose(file);
-    return 0;
+  // Top-down files go up a row at a time, still without a copy
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image.width(), image.height(), 0,
+               GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+  for (int y = 0; y < image.height(); ++y) {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, image.width(), 1, GL_BGR,
+                    GL_UNSIGNED_BYTE, image.bottomRow() + y * image.rowStep());
   }
-  if (*(int *)&(header[0x1C]) != 24) {
-    printf("Not a correct BMP file\n");
-    fclose(file);
+}
+
+GLuint loadBMP_custom(const char *imagepath) {
+  MappedBMP image;
+  if (!image.open(imagepath)) {
     return 0;
   }
 
-  // Read the information about the image
-  dataPos = *(int *)&(header[0x0A]);
-  imageSize = *(int *)&(header[0x22]);
-  width = *(int *)&(header[0x12]);
-  height = *(int *)&(header[0x16]);
-
-  // Some BMP files are misformatted, guess missing information
-  if (imageSize == 0)
-    imageSize = width * height *
-                3; // 3 : one byte for each Red, Green and Blue component
-  if (dataPos == 0)
-    dataPos = 54; // The BMP header is done that way
-
-  // Create a buffer
-  data = new unsigned char[imageSize];
-
-  // Read the actual data from the file into the buffer
-  fread(data, 1, imageSize, file);
-
-  // Everything is in memory now, the file can be closed.
-  fclose(file);
-
   // Create one OpenGL texture
   GLuint textureID;
   glGenTextures(1, &textureID);
@@ -79,15 +39,7 @@ GLuint loadBMP_custom(const char *imagepath) {
   glBindTexture(GL_TEXTURE_2D, textureID);
 
   // Give the image to OpenGL
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_BGR,
-               GL_UNSIGNED_BYTE, data);
-
-  // OpenGL has now copied the data. Free our own version
-  delete[] data;
-
-  // Poor filtering, or ...
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  // glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  uploadBMP(image);
 
   // ... nice trilinear filtering ...
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -101,3 +53,234 @@ GLuint loadBMP_custom(const char *imagepath) {
   // Return the ID of the texture we just created
   return textureID;
 }
+
+bool compressedFormatSupported(CompressedFormat format) {
+  return format == FormatBC1 ? GLEW_EXT_texture_compression_s3tc != 0
+                             : GLEW_ARB_texture_compression_bptc != 0;
+}
+
+GLenum compressedInternalFormat(CompressedFormat format) {
+  return format == FormatBC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+                             : GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+GLuint loadDDS(const char *path) {
+  MappedDDS image;
+  if (!image.open(path)) {
+    return 0;
+  }
+  if (!compressedFormatSupported(image.format())) {
+    std::cerr << "Error: " << path << " uses a format the driver lacks"
+              << std::endl;
+    return 0;
+  }
+
+  GLuint textureID;
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+
+  // Every level comes from the file, nothing is generated at load
+  GLenum internalFormat = compressedInternalFormat(image.format());
+  for (int level = 0; level < image.levelCount(); ++level) {
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat,
+                           image.levelWidth(level), image.levelHeight(level),
+                           0, (GLsizei)image.levelSize(level),
+                           image.levelData(level));
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                  image.levelCount() - 1);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+  return textureID;
+}
+
+GLuint loadTexture(const char *imagepath) {
+  std::string compressed = compressedPath(imagepath);
+  if (access(compressed.c_str(), R_OK) == 0) {
+    GLuint textureID = loadDDS(compressed.c_str());
+    if (textureID != 0) {
+      return textureID;
+    }
+  }
+  return loadBMP_custom(imagepath);
+}
+
+// Copy every level of a mapped DDS into layer of data
+static void appendCompressed(const MappedDDS &image, int layer,
+                             TextureData &data) {
+  for (int level = 0; level < image.levelCount(); ++level) {
+    const TextureData::Level &target = data.levels[level];
+    memcpy(data.bytes.data() + target.offset + layer * target.size,
+           image.levelData(level), target.size);
+  }
+}
+
+// Lay out levels for count layers of a DDS shaped like image
+static void layoutCompressed(const MappedDDS &image, int count,
+                             TextureData &data) {
+  data.compressed = true;
+  data.format = image.format();
+  data.levels.clear();
+  size_t offset = 0;
+  for (int level = 0; level < image.levelCount(); ++level) {
+    data.levels.push_back({image.levelWidth(level), image.levelHeight(level),
+                           offset, image.levelSize(level)});
+    offset += image.levelSize(level) * count;
+  }
+  data.bytes.resize(offset);
+}
+
+static void layoutUncompressed(int width, int height, int count,
+                               TextureData &data) {
+  size_t size = size_t(width) * height * 3;
+  data.compressed = false;
+  data.levels.assign(1, {width, height, 0, size});
+  data.bytes.resize(size * std::max(count, 1));
+}
+
+bool decodeTexture(const char *imagepath, TextureData &data) {
+  data.layers = 0;
+  std::string compressed = compressedPath(imagepath);
+  if (access(compressed.c_str(), R_OK) == 0) {
+    MappedDDS image;
+    if (image.open(compressed.c_str()) &&
+        compressedFormatSupported(image.format())) {
+      layoutCompressed(image, 1, data);
+      appendCompressed(image, 0, data);
+      return true;
+    }
+  }
+
+  MappedBMP image;
+  if (!image.open(imagepath)) {
+    return false;
+  }
+  // Drop the row padding while copying, bottom row first
+  layoutUncompressed(image.width(), image.height(), 1, data);
+  size_t rowBytes = size_t(image.width()) * 3;
+  for (int y = 0; y < image.height(); ++y) {
+    memcpy(data.bytes.data() + y * rowBytes,
+           image.bottomRow() + y * image.rowStep(), rowBytes);
+  }
+  return true;
+}
+
+bool decodeTextureArray(const char *const *paths, int count, int layerWidth,
+                        int layerHeight, TextureData &data) {
+  data.layers = count;
+
+  // Only when every layer has a .dds of the layer size in one format with
+  // the same mip chain, otherwise the whole array falls back to BMPs
+  std::vector<MappedDDS> images(count);
+  bool allCompressed = count > 0;
+  for (int i = 0; i < count && allCompressed; ++i) {
+    std::string path = compressedPath(paths[i]);
+    MappedDDS &image = images[i];
+    allCompressed = access(path.c_str(), R_OK) == 0 &&
+                    image.open(path.c_str()) && image.width() == layerWidth &&
+                    image.height() == layerHeight &&
+                    image.format() == images[0].format() &&
+                    image.levelCount() == images[0].levelCount() &&
+                    compressedFormatSupported(image.format());
+  }
+  if (allCompressed) {
+    layoutCompressed(images[0], count, data);
+    for (int i = 0; i < count; ++i) {
+      appendCompressed(images[i], i, data);
+    }
+    return true;
+  }
+  images.clear();
+
+  layoutUncompressed(layerWidth, layerHeight, count, data);
+  size_t layerSize = data.levels[0].size;
+  bool loadedAll = true;
+  for (int i = 0; i < count; ++i) {
+    unsigned char *layer = data.bytes.data() + i * layerSize;
+    MappedBMP image;
+    if (image.open(paths[i])) {
+      // Walk the mapped rows bottom to top, matching GL's row order
+      resizeImage(image.bottomRow(), image.width(), image.height(),
+                  image.rowStep(), layer, layerWidth, layerHeight);
+    } else {
+      memset(layer, 128, layerSize);
+      loadedAll = false;
+    }
+  }
+  return loadedAll;
+}
+
+void placeholderTexture(int layers, TextureData &data) {
+  data.layers = layers;
+  layoutUncompressed(1, 1, layers, data);
+  memset(data.bytes.data(), 128, data.bytes.size());
+}
+
+void uploadTexture(GLuint texture, const TextureData &data,
+                   GLuint pixelBuffer) {
+  GLenum target = data.layers > 0 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+  GLsizei layers = std::max(data.layers, 1);
+  glBindTexture(target, texture);
+
+  // Through the unpack buffer, pixel pointers become offsets into it
+  uintptr_t base = reinterpret_cast<uintptr_t>(data.bytes.data());
+  if (pixelBuffer != 0) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffer);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, data.bytes.size(), nullptr,
+                 GL_STREAM_DRAW);
+    void *staging = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, data.bytes.size(),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (staging) {
+      memcpy(staging, data.bytes.data(), data.bytes.size());
+    }
+    if (staging && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+      base = 0;
+    } else {
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+  }
+
+  GLenum internalFormat =
+      data.compressed ? compressedInternalFormat(data.format) : GL_RGB8;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t level = 0; level < data.levels.size(); ++level) {
+    const TextureData::Level &l = data.levels[level];
+    const void *pixels = reinterpret_cast<const void *>(base + l.offset);
+    GLsizei size = (GLsizei)(l.size * layers);
+    if (data.compressed && data.layers > 0) {
+      glCompressedTexImage3D(target, level, internalFormat, l.width, l.height,
+                             layers, 0, size, pixels);
+    } else if (data.compressed) {
+      glCompressedTexImage2D(target, level, internalFormat, l.width, l.height,
+                             0, size, pixels);
+    } else if (data.layers > 0) {
+      glTexImage3D(target, level, internalFormat, l.width, l.height, layers,
+                   0, GL_BGR, GL_UNSIGNED_BYTE, pixels);
+    } else {
+      glTexImage2D(target, level, internalFormat, l.width, l.height, 0,
+                   GL_BGR, GL_UNSIGNED_BYTE, pixels);
+    }
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  if (pixelBuffer != 0) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  // Compressed data brings its chain, the rest is generated here
+  if (data.compressed) {
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL,
+                    (GLint)data.levels.size() - 1);
+  } else {
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, 1000);
+    glGenerateMipmap(target);
+  }
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+}
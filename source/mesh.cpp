@@ -0,0 +1,312 @@
+#include "mesh.h"
+#include "meshorder.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Rows handed to one thread; meshes below a few thousand vertices stay on the
+// calling thread, where waking the pool would cost more than the work
+static size_t rowGrain(int sectors) {
+  size_t grain = 16384 / size_t(sectors + 1);
+  return grain > 0 ? grain : 1;
+}
+
+void generateSphereVertices(float radius, int sectors, int stacks,
+                            SphereMesh &mesh) {
+  size_t columns = sectors + 1;
+  size_t vertexCount = columns * (stacks + 1);
+  mesh.vertices.resize(vertexCount * 3);
+  mesh.colors.resize(vertexCount * 3);
+  mesh.textureCoords.resize(vertexCount * 2);
+
+  // Every ring shares the sector angles and every stack one latitude, so
+  // the trig is done once per column and once per row rather than per vertex
+  float sectorStep = 2 * M_PI / sectors; // Angle step
+  float stackStep = M_PI / stacks;       // Angle step
+  std::vector<float> tables(3 * columns + 2 * (stacks + 1));
+  float *sectorCos = tables.data();
+  float *sectorSin = sectorCos + columns;
+  float *sectorU = sectorSin + columns;
+  float *stackXY = sectorU + columns;
+  float *stackZ = stackXY + stacks + 1;
+  for (int j = 0; j < sectors; ++j) {
+    float sectorAngle = j * sectorStep; // Current angle
+    sectorCos[j] = cosf(sectorAngle);
+    sectorSin[j] = sinf(sectorAngle);
+  }
+  // The seam column repeats the first exactly, so the mesh closes
+  sectorCos[sectors] = sectorCos[0];
+  sectorSin[sectors] = sectorSin[0];
+  for (int j = 0; j <= sectors; ++j) {
+    sectorU[j] = (float)j / sectors; // U coordinate
+  }
+  for (int i = 0; i <= stacks; ++i) {
+    float stackAngle = M_PI / 2 - i * stackStep; // Current angle
+    stackXY[i] = radius * cosf(stackAngle);      // Projected radius
+    stackZ[i] = radius * sinf(stackAngle);       // Z position
+  }
+
+  float lengthInv = 1.0f / radius;
+  float *vertices = mesh.vertices.data();
+  float *colors = mesh.colors.data();
+  float *textureCoords = mesh.textureCoords.data();
+  parallelFor(stacks + 1, rowGrain(sectors), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      float xy = stackXY[i];
+      float z = stackZ[i];
+      float v = (float)i / stacks; // V coordinate
+      size_t row = i * columns;
+      // Branch free over the row, straight stores into the final buffers
+      for (size_t j = 0; j < columns; ++j) {
+        float x = xy * sectorCos[j];
+        float y = xy * sectorSin[j];
+        size_t k = row + j;
+        vertices[3 * k] = x;
+        vertices[3 * k + 1] = y;
+        vertices[3 * k + 2] = z;
+        colors[3 * k] = 0.5f + 0.5f * x * lengthInv;
+        colors[3 * k + 1] = 0.5f + 0.5f * y * lengthInv;
+        colors[3 * k + 2] = 0.5f + 0.5f * z * lengthInv;
+        textureCoords[2 * k] = sectorU[j];
+        textureCoords[2 * k + 1] = v;
+      }
+    }
+  });
+}
+
+void generateSphereIndices(int sectors, int stacks, SphereMesh &mesh) {
+  size_t columns = sectors + 1;
+  mesh.indices.resize(size_t(sectors) * stacks * 6);
+  unsigned int *indices = mesh.indices.data();
+
+  // Two triangles per quad between stack i and i + 1
+  parallelFor(stacks, rowGrain(sectors), [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      unsigned int *out = indices + i * sectors * 6;
+      for (int j = 0; j < sectors; ++j) {
+        unsigned int first = i * columns + j;
+        unsigned int second = first + columns;
+        out[0] = first;
+        out[1] = second;
+        out[2] = first + 1;
+
+        out[3] = second;
+        out[4] = second + 1;
+        out[5] = first + 1;
+        out += 6;
+      }
+    }
+  });
+}
+
+// Copy vertex v to the end of the mesh, returning the copy's index
+static unsigned int duplicateVertex(SphereMesh &mesh, unsigned int v) {
+  unsigned int copy = (unsigned int)(mesh.vertices.size() / 3);
+  for (int k = 0; k < 3; ++k) {
+    mesh.vertices.push_back(mesh.vertices[3 * v + k]);
+  }
+  mesh.textureCoords.push_back(mesh.textureCoords[2 * v]);
+  mesh.textureCoords.push_back(mesh.textureCoords[2 * v + 1]);
+  return copy;
+}
+
+// Finish a unit sphere of vertices and indices: the UV sphere's mapping of
+// u to longitude and v to colatitude, colors, the radius and a cache and
+// overdraw friendly triangle order. Triangles across the u = 0 seam or
+// touching a pole get their own copies of those vertices, or the texture
+// would smear back across the whole of u.
+static void finishSphereMesh(float radius, SphereMesh &mesh) {
+  size_t vertexCount = mesh.vertices.size() / 3;
+  mesh.textureCoords.resize(vertexCount * 2);
+  std::vector<bool> pole(vertexCount);
+  for (size_t i = 0; i < vertexCount; ++i) {
+    float x = mesh.vertices[3 * i];
+    float y = mesh.vertices[3 * i + 1];
+    float z = std::max(-1.0f, std::min(1.0f, mesh.vertices[3 * i + 2]));
+    float u = atan2f(y, x) / float(2 * M_PI);
+    mesh.textureCoords[2 * i] = u < 0.0f ? u + 1.0f : u;
+    mesh.textureCoords[2 * i + 1] = acosf(z) / float(M_PI);
+    pole[i] = fabsf(x) < 1e-6f && fabsf(y) < 1e-6f;
+  }
+
+  std::vector<unsigned int> seamCopy(vertexCount, UINT32_MAX);
+  for (size_t t = 0; t < mesh.indices.size(); t += 3) {
+    unsigned int *triangle = &mesh.indices[t];
+    float low = 1.0f, high = 0.0f;
+    for (int k = 0; k < 3; ++k) {
+      if (!pole[triangle[k]]) {
+        low = std::min(low, mesh.textureCoords[2 * triangle[k]]);
+        high = std::max(high, mesh.textureCoords[2 * triangle[k]]);
+      }
+    }
+    // Wrapped: the vertices near u = 0 continue past u = 1 instead
+    if (high - low > 0.5f) {
+      for (int k = 0; k < 3; ++k) {
+        unsigned int v = triangle[k];
+        if (!pole[v] && mesh.textureCoords[2 * v] < 0.5f) {
+          if (seamCopy[v] == UINT32_MAX) {
+            seamCopy[v] = duplicateVertex(mesh, v);
+            mesh.textureCoords[2 * seamCopy[v]] += 1.0f;
+          }
+          triangle[k] = seamCopy[v];
+        }
+      }
+    }
+    // A pole has no longitude, each triangle gets one between its others
+    for (int k = 0; k < 3; ++k) {
+      if (triangle[k] < vertexCount && pole[triangle[k]]) {
+        unsigned int copy = duplicateVertex(mesh, triangle[k]);
+        float a = mesh.textureCoords[2 * triangle[(k + 1) % 3]];
+        float b = mesh.textureCoords[2 * triangle[(k + 2) % 3]];
+        mesh.textureCoords[2 * copy] = 0.5f * (a + b);
+        triangle[k] = copy;
+      }
+    }
+  }
+
+  vertexCount = mesh.vertices.size() / 3;
+  mesh.colors.resize(vertexCount * 3);
+  for (size_t i = 0; i < vertexCount * 3; ++i) {
+    mesh.colors[i] = 0.5f + 0.5f * mesh.vertices[i];
+    mesh.vertices[i] *= radius;
+  }
+
+  optimizeVertexCache(mesh.indices, vertexCount);
+  optimizeOverdraw(mesh.indices, mesh.vertices);
+}
+
+// Index of the normalized midpoint of edge a-b, shared by both triangles on
+// the edge
+static unsigned int midpoint(
+    unsigned int a, unsigned int b, SphereMesh &mesh,
+    std::unordered_map<uint64_t, unsigned int> &midpoints) {
+  uint64_t key = (uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+  auto found = midpoints.find(key);
+  if (found != midpoints.end()) {
+    return found->second;
+  }
+  float m[3];
+  for (int k = 0; k < 3; ++k) {
+    m[k] = 0.5f * (mesh.vertices[3 * a + k] + mesh.vertices[3 * b + k]);
+  }
+  float lengthInv = 1.0f / sqrtf(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+  unsigned int index = (unsigned int)(mesh.vertices.size() / 3);
+  for (int k = 0; k < 3; ++k) {
+    mesh.vertices.push_back(m[k] * lengthInv);
+  }
+  midpoints.emplace(key, index);
+  return index;
+}
+
+void generateIcosphere(float radius, int subdivisions, SphereMesh &mesh) {
+  // Icosahedron on the unit sphere, counter-clockwise from outside
+  const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+  const float corners[12][3] = {{-1, t, 0}, {1, t, 0},  {-1, -t, 0},
+                                {1, -t, 0}, {0, -1, t}, {0, 1, t},
+                                {0, -1, -t}, {0, 1, -t}, {t, 0, -1},
+                                {t, 0, 1},  {-t, 0, -1}, {-t, 0, 1}};
+  const unsigned int faces[20][3] = {
+      {0, 11, 5}, {0, 5, 1},  {0, 1, 7},   {0, 7, 10}, {0, 10, 11},
+      {1, 5, 9},  {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+      {3, 9, 4},  {3, 4, 2},  {3, 2, 6},   {3, 6, 8},  {3, 8, 9},
+      {4, 9, 5},  {2, 4, 11}, {6, 2, 10},  {8, 6, 7},  {9, 8, 1}};
+
+  size_t finalVertices = 10 * (size_t(1) << (2 * subdivisions)) + 2;
+  mesh.vertices.clear();
+  mesh.vertices.reserve(finalVertices * 3);
+  float lengthInv = 1.0f / sqrtf(1.0f + t * t);
+  for (const float *corner : corners) {
+    for (int k = 0; k < 3; ++k) {
+      mesh.vertices.push_back(corner[k] * lengthInv);
+    }
+  }
+  mesh.indices.assign(&faces[0][0], &faces[0][0] + 60);
+
+  // Every level splits each triangle into four at its edge midpoints
+  std::unordered_map<uint64_t, unsigned int> midpoints;
+  std::vector<unsigned int> split;
+  for (int level = 0; level < subdivisions; ++level) {
+    midpoints.clear();
+    midpoints.reserve(mesh.indices.size() / 2);
+    split.resize(mesh.indices.size() * 4);
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+      unsigned int a = mesh.indices[i];
+      unsigned int b = mesh.indices[i + 1];
+      unsigned int c = mesh.indices[i + 2];
+      unsigned int ab = midpoint(a, b, mesh, midpoints);
+      unsigned int bc = midpoint(b, c, mesh, midpoints);
+      unsigned int ca = midpoint(c, a, mesh, midpoints);
+      const unsigned int children[12] = {a, ab, ca, b, bc, ab,
+                                         c, ca, bc, ab, bc, ca};
+      std::copy(children, children + 12, &split[4 * i]);
+    }
+    mesh.indices.swap(split);
+  }
+  finishSphereMesh(radius, mesh);
+}
+
+void generateCubeSphere(float radius, int divisions, SphereMesh &mesh) {
+  // Face normal, then its two grid axes with s x t = normal so the quads
+  // wind counter-clockwise from outside
+  const int axes[6][3][3] = {
+      {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}},  {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+      {{0, 1, 0}, {0, 0, 1}, {1, 0, 0}},  {{0, -1, 0}, {1, 0, 0}, {0, 0, 1}},
+      {{0, 0, 1}, {1, 0, 0}, {0, 1, 0}},  {{0, 0, -1}, {0, 1, 0}, {1, 0, 0}}};
+
+  int n = divisions;
+  size_t side = size_t(n) + 1;
+  mesh.vertices.clear();
+  mesh.vertices.reserve((6 * size_t(n) * n + 2) * 3);
+  mesh.indices.clear();
+  mesh.indices.reserve(36 * size_t(n) * n);
+
+  // Vertices are keyed by their integer lattice point, so the edges and
+  // corners the faces share are welded
+  std::unordered_map<uint64_t, unsigned int> lattice;
+  lattice.reserve(6 * size_t(n) * n + 2);
+  std::vector<unsigned int> grid(side * side);
+  for (const auto &face : axes) {
+    for (int j = 0; j <= n; ++j) {
+      for (int i = 0; i <= n; ++i) {
+        // Lattice point in [0, n]^3; the grid axes are all positive
+        int p[3];
+        for (int k = 0; k < 3; ++k) {
+          p[k] = (face[0][k] > 0 ? n : 0) + i * face[1][k] + j * face[2][k];
+        }
+        uint64_t key = (uint64_t(p[0]) * side + p[1]) * side + p[2];
+        auto found = lattice.find(key);
+        if (found != lattice.end()) {
+          grid[j * side + i] = found->second;
+          continue;
+        }
+        // Spread the cube onto the sphere with its area nearly uniform
+        float c[3], s[3];
+        for (int k = 0; k < 3; ++k) {
+          c[k] = -1.0f + 2.0f * p[k] / n;
+        }
+        float x2 = c[0] * c[0], y2 = c[1] * c[1], z2 = c[2] * c[2];
+        s[0] = c[0] * sqrtf(1.0f - y2 / 2 - z2 / 2 + y2 * z2 / 3);
+        s[1] = c[1] * sqrtf(1.0f - z2 / 2 - x2 / 2 + z2 * x2 / 3);
+        s[2] = c[2] * sqrtf(1.0f - x2 / 2 - y2 / 2 + x2 * y2 / 3);
+        unsigned int index = (unsigned int)(mesh.vertices.size() / 3);
+        mesh.vertices.insert(mesh.vertices.end(), s, s + 3);
+        lattice.emplace(key, index);
+        grid[j * side + i] = index;
+      }
+    }
+    for (int j = 0; j < n; ++j) {
+      for (int i = 0; i < n; ++i) {
+        unsigned int a = grid[j * side + i];
+        unsigned int b = grid[j * side + i + 1];
+        unsigned int c = grid[(j + 1) * side + i + 1];
+        unsigned int d = grid[(j + 1) * side + i];
+        const unsigned int quad[6] = {a, b, c, a, c, d};
+        mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+      }
+    }
+  }
+  finishSphereMesh(radius, mesh);
+}
@@ -0,0 +1,310 @@
+#include "meshorder.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// LRU entries scored by the optimizer, larger than the simulated FIFO so
+// vertices about to drop out still pull their triangles forward
+const int scoreCacheSize = 32;
+const int maxValenceScored = 32;
+
+// Forsyth's tuned weights
+const float cacheDecayPower = 1.5f;
+const float lastTriangleScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+
+struct ScoreTables {
+  float cache[scoreCacheSize];
+  float valence[maxValenceScored + 1];
+
+  ScoreTables() {
+    for (int i = 0; i < scoreCacheSize; ++i) {
+      // The last triangle's vertices score flat so its neighbours do not
+      // win just by sharing the newest one
+      cache[i] = i < 3 ? lastTriangleScore
+                       : powf(1.0f - float(i - 3) / (scoreCacheSize - 3),
+                              cacheDecayPower);
+    }
+    valence[0] = 0.0f;
+    for (int i = 1; i <= maxValenceScored; ++i) {
+      valence[i] = valenceBoostScale * powf(float(i), -valenceBoostPower);
+    }
+  }
+
+  // Vertices with few triangles left are finished off first
+  float score(int cachePosition, unsigned int liveTriangles) const {
+    if (liveTriangles == 0) {
+      return -1.0f;
+    }
+    float total = valence[std::min<unsigned int>(liveTriangles,
+                                                 maxValenceScored)];
+    if (cachePosition >= 0) {
+      total += cache[cachePosition];
+    }
+    return total;
+  }
+};
+
+// FIFO cache simulated with stamps, so a flush is one addition
+struct FifoCache {
+  std::vector<uint32_t> stamps;
+  uint32_t time;
+  uint32_t size;
+
+  FifoCache(size_t vertexCount, unsigned int cacheSize)
+      : stamps(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+  // Whether the vertex had to be transformed
+  bool miss(unsigned int vertex) {
+    if (time - stamps[vertex] <= size) {
+      return false;
+    }
+    stamps[vertex] = time++;
+    return true;
+  }
+
+  void flush() { time += size + 1; }
+
+  unsigned int triangleMisses(const unsigned int *triangle) {
+    return miss(triangle[0]) + miss(triangle[1]) + miss(triangle[2]);
+  }
+};
+
+} // namespace
+
+void optimizeVertexCache(std::vector<unsigned int> &indices,
+                         size_t vertexCount) {
+  static const ScoreTables tables;
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Triangles around every vertex, packed; the first liveTriangles[v] of a
+  // vertex's slice are the ones not yet emitted
+  std::vector<unsigned int> liveTriangles(vertexCount, 0);
+  for (unsigned int index : indices) {
+    ++liveTriangles[index];
+  }
+  std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    firstTriangle[v + 1] = firstTriangle[v] + liveTriangles[v];
+  }
+  std::vector<unsigned int> adjacency(indices.size());
+  std::vector<size_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+  for (size_t t = 0; t < triangleCount; ++t) {
+    for (int k = 0; k < 3; ++k) {
+      adjacency[filled[indices[3 * t + k]]++] = (unsigned int)t;
+    }
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> vertexScore(vertexCount);
+  for (size_t v = 0; v < vertexCount; ++v) {
+    vertexScore[v] = tables.score(-1, liveTriangles[v]);
+  }
+  std::vector<bool> emitted(triangleCount, false);
+  size_t best = 0;
+  float bestScore = -1.0f;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    const unsigned int *triangle = &indices[3 * t];
+    float score = vertexScore[triangle[0]] + vertexScore[triangle[1]] +
+                  vertexScore[triangle[2]];
+    if (score > bestScore) {
+      bestScore = score;
+      best = t;
+    }
+  }
+
+  std::vector<unsigned int> output(indices.size());
+  std::vector<unsigned int> cache, nextCache;
+  cache.reserve(scoreCacheSize + 3);
+  nextCache.reserve(scoreCacheSize + 3);
+  size_t nextUnemitted = 0; // Restart point once the cache runs dry
+  for (size_t out = 0; out < triangleCount; ++out) {
+    if (best == SIZE_MAX) {
+      while (emitted[nextUnemitted]) {
+        ++nextUnemitted;
+      }
+      best = nextUnemitted;
+    }
+    const unsigned int *triangle = &indices[3 * best];
+    std::copy(triangle, triangle + 3, &output[3 * out]);
+    emitted[best] = true;
+
+    // Retire the triangle from its vertices' live lists
+    for (int k = 0; k < 3; ++k) {
+      unsigned int v = triangle[k];
+      unsigned int *live = &adjacency[firstTriangle[v]];
+      unsigned int *end = live + liveTriangles[v];
+      *std::find(live, end, (unsigned int)best) = end[-1];
+      --liveTriangles[v];
+    }
+
+    // Its vertices move to the front of the LRU, pushing the rest back
+    nextCache.assign(triangle, triangle + 3);
+    for (unsigned int v : cache) {
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+        nextCache.push_back(v);
+      }
+    }
+    for (size_t i = 0; i < nextCache.size(); ++i) {
+      unsigned int v = nextCache[i];
+      cachePosition[v] = i < size_t(scoreCacheSize) ? int(i) : -1;
+      vertexScore[v] = tables.score(cachePosition[v], liveTriangles[v]);
+    }
+
+    // Only triangles touching the cache changed score; the best of them
+    // goes next
+    best = SIZE_MAX;
+    bestScore = -1.0f;
+    for (unsigned int v : nextCache) {
+      const unsigned int *live = &adjacency[firstTriangle[v]];
+      for (unsigned int i = 0; i < liveTriangles[v]; ++i) {
+        unsigned int t = live[i];
+        const unsigned int *other = &indices[3 * t];
+        float score = vertexScore[other[0]] + vertexScore[other[1]] +
+                      vertexScore[other[2]];
+        if (score > bestScore) {
+          bestScore = score;
+          best = t;
+        }
+      }
+    }
+    if (nextCache.size() > size_t(scoreCacheSize)) {
+      nextCache.resize(scoreCacheSize);
+    }
+    cache.swap(nextCache);
+  }
+  indices.swap(output);
+}
+
+void optimizeOverdraw(std::vector<unsigned int> &indices,
+                      const std::vector<float> &vertices, float threshold) {
+  size_t triangleCount = indices.size() / 3;
+  size_t vertexCount = vertices.size() / 3;
+  if (triangleCount == 0) {
+    return;
+  }
+
+  // Hard boundaries where the order already restarts, a triangle with no
+  // cached vertex
+  FifoCache cache(vertexCount, vertexCacheSize);
+  std::vector<size_t> hardStarts;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    if (cache.triangleMisses(&indices[3 * t]) == 3) {
+      hardStarts.push_back(t);
+    }
+  }
+  hardStarts.push_back(triangleCount);
+
+  // Soft boundaries inside each run, wherever a fresh cache has already
+  // caught up with the run's own miss ratio
+  std::vector<size_t> starts;
+  for (size_t h = 0; h + 1 < hardStarts.size(); ++h) {
+    size_t begin = hardStarts[h], end = hardStarts[h + 1];
+    cache.flush();
+    unsigned int runMisses = 0;
+    for (size_t t = begin; t < end; ++t) {
+      runMisses += cache.triangleMisses(&indices[3 * t]);
+    }
+    float limit = threshold * float(runMisses) / float(end - begin);
+
+    cache.flush();
+    starts.push_back(begin);
+    unsigned int misses = 0;
+    for (size_t t = begin; t + 1 < end; ++t) {
+      misses += cache.triangleMisses(&indices[3 * t]);
+      if (misses <= limit * float(t + 1 - starts.back())) {
+        starts.push_back(t + 1);
+        misses = 0;
+        cache.flush();
+      }
+    }
+  }
+  starts.push_back(triangleCount);
+
+  // Area weighted centre and normal of each cluster
+  size_t clusterCount = starts.size() - 1;
+  std::vector<float> centres(clusterCount * 3, 0.0f);
+  std::vector<float> normals(clusterCount * 3, 0.0f);
+  std::vector<float> areas(clusterCount, 0.0f);
+  double meshCentre[3] = {0.0, 0.0, 0.0};
+  double meshArea = 0.0;
+  for (size_t c = 0; c < clusterCount; ++c) {
+    float *centre = &centres[3 * c];
+    float *normal = &normals[3 * c];
+    for (size_t t = starts[c]; t < starts[c + 1]; ++t) {
+      const float *a = &vertices[3 * indices[3 * t]];
+      const float *b = &vertices[3 * indices[3 * t + 1]];
+      const float *d = &vertices[3 * indices[3 * t + 2]];
+      float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+      float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (int k = 0; k < 3; ++k) {
+        centre[k] += area * (a[k] + b[k] + d[k]) / 3.0f;
+        normal[k] += n[k];
+      }
+      areas[c] += area;
+    }
+    for (int k = 0; k < 3; ++k) {
+      meshCentre[k] += centre[k];
+    }
+    meshArea += areas[c];
+  }
+  for (int k = 0; k < 3; ++k) {
+    meshCentre[k] = meshArea > 0.0 ? meshCentre[k] / meshArea : 0.0;
+  }
+
+  // Clusters far out along their own normal are the likely occluders
+  std::vector<float> sortKeys(clusterCount);
+  for (size_t c = 0; c < clusterCount; ++c) {
+    const float *normal = &normals[3 * c];
+    float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] +
+                         normal[2] * normal[2]);
+    float key = 0.0f;
+    if (areas[c] > 0.0f && length > 0.0f) {
+      for (int k = 0; k < 3; ++k) {
+        float offset = centres[3 * c + k] / areas[c] - float(meshCentre[k]);
+        key += offset * normal[k] / length;
+      }
+    }
+    sortKeys[c] = key;
+  }
+  std::vector<unsigned int> order(clusterCount);
+  for (size_t c = 0; c < clusterCount; ++c) {
+    order[c] = (unsigned int)c;
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](unsigned int a, unsigned int b) {
+                     return sortKeys[a] > sortKeys[b];
+                   });
+
+  std::vector<unsigned int> output;
+  output.reserve(indices.size());
+  for (unsigned int c : order) {
+    output.insert(output.end(), indices.begin() + 3 * starts[c],
+                  indices.begin() + 3 * starts[c + 1]);
+  }
+  indices.swap(output);
+}
+
+double averageCacheMissRatio(const std::vector<unsigned int> &indices,
+                             size_t vertexCount, unsigned int cacheSize) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) {
+    return 0.0;
+  }
+  FifoCache cache(vertexCount, cacheSize);
+  size_t misses = 0;
+  for (size_t t = 0; t < triangleCount; ++t) {
+    misses += cache.triangleMisses(&indices[3 * t]);
+  }
+  return double(misses) / triangleCount;
+}
@@ -0,0 +1,325 @@
+#include "metrics.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+// Upper bounds of the frame time histogram buckets in milliseconds, the last
+// bucket is +Inf
+const int bucketCount = 11;
+const double bucketBounds[bucketCount - 1] = {1.0,  2.0,  4.0,   8.0,   16.7,
+                                              33.3, 50.0, 100.0, 250.0, 1000.0};
+
+std::atomic<uint64_t> steps{0};
+std::atomic<uint64_t> collisions{0};
+std::atomic<uint64_t> frameBuckets[bucketCount];
+std::atomic<uint64_t> frameMicroseconds{0};
+std::atomic<double> energyDrift{0.0};
+
+std::atomic<bool> running{false};
+std::thread exporter;
+
+// Everything below is only touched by the exporter thread
+MetricsConfig settings;
+FILE *jsonFile = nullptr;
+int listenSocket = -1;
+std::string exposition; // Latest Prometheus text, served over HTTP
+
+struct Sample {
+  uint64_t steps;
+  uint64_t collisions;
+  uint64_t buckets[bucketCount];
+  uint64_t frameMicroseconds;
+  std::chrono::steady_clock::time_point time;
+};
+Sample previous;
+
+Sample takeSample() {
+  Sample sample;
+  sample.steps = steps.load(std::memory_order_relaxed);
+  sample.collisions = collisions.load(std::memory_order_relaxed);
+  for (int b = 0; b < bucketCount; ++b) {
+    sample.buckets[b] = frameBuckets[b].load(std::memory_order_relaxed);
+  }
+  sample.frameMicroseconds = frameMicroseconds.load(std::memory_order_relaxed);
+  sample.time = std::chrono::steady_clock::now();
+  return sample;
+}
+
+// Percentile of the frames in a histogram, interpolated within its bucket
+double percentile(const uint64_t *counts, uint64_t total, double fraction) {
+  if (total == 0) {
+    return 0.0;
+  }
+  double rank = fraction * total;
+  uint64_t below = 0;
+  for (int b = 0; b < bucketCount - 1; ++b) {
+    if (below + counts[b] >= rank) {
+      double lower = b > 0 ? bucketBounds[b - 1] : 0.0;
+      double within = counts[b] ? (rank - below) / counts[b] : 0.0;
+      return lower + within * (bucketBounds[b] - lower);
+    }
+    below += counts[b];
+  }
+  return bucketBounds[bucketCount - 2];
+}
+
+void appendf(std::string &text, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list copy;
+  va_copy(copy, args);
+  int length = vsnprintf(nullptr, 0, format, copy);
+  va_end(copy);
+  if (length > 0) {
+    size_t offset = text.size();
+    text.resize(offset + length + 1);
+    vsnprintf(&text[offset], length + 1, format, args);
+    text.resize(offset + length);
+  }
+  va_end(args);
+}
+
+void writeSample() {
+  Sample current = takeSample();
+  double seconds =
+      std::chrono::duration<double>(current.time - previous.time).count();
+  if (seconds <= 0.0) {
+    seconds = 1.0;
+  }
+  double stepRate = (current.steps - previous.steps) / seconds;
+  double collisionRate = (current.collisions - previous.collisions) / seconds;
+  uint64_t intervalCounts[bucketCount];
+  uint64_t intervalFrames = 0;
+  for (int b = 0; b < bucketCount; ++b) {
+    intervalCounts[b] = current.buckets[b] - previous.buckets[b];
+    intervalFrames += intervalCounts[b];
+  }
+  double p50 = percentile(intervalCounts, intervalFrames, 0.50);
+  double p90 = percentile(intervalCounts, intervalFrames, 0.90);
+  double p99 = percentile(intervalCounts, intervalFrames, 0.99);
+  double drift = energyDrift.load(std::memory_order_relaxed);
+  previous = current;
+
+  exposition.clear();
+  appendf(exposition, "# HELP sim_steps_total Simulation steps taken.\n"
+                      "# TYPE sim_steps_total counter\n"
+                      "sim_steps_total %llu\n",
+          (unsigned long long)current.steps);
+  appendf(exposition, "# HELP sim_collisions_total Collisions resolved.\n"
+                      "# TYPE sim_collisions_total counter\n"
+                      "sim_collisions_total %llu\n",
+          (unsigned long long)current.collisions);
+  appendf(exposition, "# TYPE sim_steps_per_second gauge\n"
+                      "sim_steps_per_second %.3f\n",
+          stepRate);
+  appendf(exposition, "# TYPE sim_collisions_per_second gauge\n"
+                      "sim_collisions_per_second %.3f\n",
+          collisionRate);
+  appendf(exposition, "# HELP sim_energy_drift Relative change of the total "
+                      "energy.\n"
+                      "# TYPE sim_energy_drift gauge\n"
+                      "sim_energy_drift %g\n",
+          drift);
+  appendf(exposition, "# HELP render_frame_seconds CPU time per frame.\n"
+                      "# TYPE render_frame_seconds histogram\n");
+  uint64_t cumulative = 0;
+  uint64_t frames = 0;
+  for (int b = 0; b < bucketCount; ++b) {
+    frames += current.buckets[b];
+  }
+  for (int b = 0; b < bucketCount - 1; ++b) {
+    cumulative += current.buckets[b];
+    appendf(exposition, "render_frame_seconds_bucket{le=\"%g\"} %llu\n",
+            bucketBounds[b] * 1e-3, (unsigned long long)cumulative);
+  }
+  appendf(exposition,
+          "render_frame_seconds_bucket{le=\"+Inf\"} %llu\n"
+          "render_frame_seconds_sum %.6f\n"
+          "render_frame_seconds_count %llu\n",
+          (unsigned long long)frames, current.frameMicroseconds * 1e-6,
+          (unsigned long long)frames);
+  appendf(exposition,
+          "# HELP render_frame_quantile_seconds Frame time percentiles over "
+          "the last interval.\n"
+          "# TYPE render_frame_quantile_seconds gauge\n"
+          "render_frame_quantile_seconds{quantile=\"0.5\"} %.6f\n"
+          "render_frame_quantile_seconds{quantile=\"0.9\"} %.6f\n"
+          "render_frame_quantile_seconds{quantile=\"0.99\"} %.6f\n",
+          p50 * 1e-3, p90 * 1e-3, p99 * 1e-3);
+
+  if (jsonFile) {
+    fprintf(jsonFile,
+            "{\"time\": %lld, \"steps\": %llu, \"steps_per_second\": %.3f, "
+            "\"collisions_per_second\": %.3f, \"frames\": %llu, "
+            "\"frame_p50_ms\": %.3f, \"frame_p90_ms\": %.3f, "
+            "\"frame_p99_ms\": %.3f, \"energy_drift\": %g}\n",
+            (long long)time(nullptr), (unsigned long long)current.steps,
+            stepRate, collisionRate, (unsigned long long)intervalFrames, p50,
+            p90, p99, drift);
+    fflush(jsonFile);
+  } else if (settings.path) {
+    // Write aside and rename so a scraper never reads a partial file
+    std::string temporary = std::string(settings.path) + ".tmp";
+    FILE *file = fopen(temporary.c_str(), "w");
+    if (!file) {
+      std::cerr << "Error: Cannot open " << temporary << std::endl;
+      return;
+    }
+    fwrite(exposition.data(), 1, exposition.size(), file);
+    if (fclose(file) == 0) {
+      rename(temporary.c_str(), settings.path);
+    }
+  }
+}
+
+// Answers any request with the latest exposition and closes the connection
+void serveClient() {
+  int client = accept(listenSocket, nullptr, nullptr);
+  if (client < 0) {
+    return;
+  }
+  timeval timeout = {1, 0};
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  char request[1024];
+  if (recv(client, request, sizeof(request), 0) > 0) {
+    char header[160];
+    int length = snprintf(header, sizeof(header),
+                          "HTTP/1.1 200 OK\r\n"
+                          "Content-Type: text/plain; version=0.0.4\r\n"
+                          "Content-Length: %zu\r\n"
+                          "Connection: close\r\n\r\n",
+                          exposition.size());
+    send(client, header, length, MSG_NOSIGNAL);
+    send(client, exposition.data(), exposition.size(), MSG_NOSIGNAL);
+  }
+  close(client);
+}
+
+void exportLoop() {
+  typedef std::chrono::steady_clock Clock;
+  Clock::duration interval = std::chrono::duration_cast<Clock::duration>(
+      std::chrono::duration<double>(settings.interval));
+  Clock::time_point next = Clock::now() + interval;
+
+  while (running.load()) {
+    // Short waits so stopping never takes long
+    Clock::time_point now = Clock::now();
+    int waitMs = 0;
+    if (next > now) {
+      waitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                   next - now)
+                   .count();
+      waitMs = waitMs < 100 ? waitMs : 100;
+    }
+    pollfd listener = {listenSocket, POLLIN, 0};
+    if (poll(&listener, listenSocket >= 0 ? 1 : 0, waitMs) > 0) {
+      serveClient();
+    }
+    if (Clock::now() >= next) {
+      writeSample();
+      next += interval;
+    }
+  }
+  writeSample();
+}
+
+bool openListener(int port) {
+  listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+  if (listenSocket < 0) {
+    std::cerr << "Error: Cannot create metrics socket" << std::endl;
+    return false;
+  }
+  int reuse = 1;
+  setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in address;
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (bind(listenSocket, (sockaddr *)&address, sizeof(address)) != 0 ||
+      listen(listenSocket, 4) != 0) {
+    std::cerr << "Error: Cannot listen on 127.0.0.1:" << port << std::endl;
+    close(listenSocket);
+    listenSocket = -1;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+void metricsRecordStep(uint64_t collisionCount) {
+  steps.fetch_add(1, std::memory_order_relaxed);
+  collisions.fetch_add(collisionCount, std::memory_order_relaxed);
+}
+
+void metricsRecordFrame(double milliseconds) {
+  int b = 0;
+  while (b < bucketCount - 1 && milliseconds > bucketBounds[b]) {
+    ++b;
+  }
+  frameBuckets[b].fetch_add(1, std::memory_order_relaxed);
+  frameMicroseconds.fetch_add((uint64_t)(milliseconds * 1e3),
+                              std::memory_order_relaxed);
+}
+
+void metricsSetEnergyDrift(double drift) {
+  energyDrift.store(drift, std::memory_order_relaxed);
+}
+
+bool startMetricsExporter(const MetricsConfig &config) {
+  if (running.load()) {
+    return false;
+  }
+  settings = config;
+  if (settings.interval <= 0.0) {
+    settings.interval = 1.0;
+  }
+  if (settings.path && settings.format == MetricsJsonLines) {
+    jsonFile = fopen(settings.path, "a");
+    if (!jsonFile) {
+      std::cerr << "Error: Cannot open " << settings.path << std::endl;
+      return false;
+    }
+  }
+  if (settings.httpPort > 0 && !openListener(settings.httpPort)) {
+    if (jsonFile) {
+      fclose(jsonFile);
+      jsonFile = nullptr;
+    }
+    return false;
+  }
+
+  previous = takeSample();
+  running.store(true);
+  exporter = std::thread(exportLoop);
+  return true;
+}
+
+void stopMetricsExporter() {
+  if (!running.exchange(false)) {
+    return;
+  }
+  exporter.join();
+  if (jsonFile) {
+    fclose(jsonFile);
+    jsonFile = nullptr;
+  }
+  if (listenSocket >= 0) {
+    close(listenSocket);
+    listenSocket = -1;
+  }
+}
@@ -0,0 +1,147 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Job {
+  RangeFunction function;
+  void *context;
+  size_t count;
+  size_t grain;
+  std::atomic<size_t> next;
+};
+
+thread_local size_t threadIndex = 0;
+thread_local bool insideJob = false;
+
+void runChunks(Job &job) {
+  for (;;) {
+    size_t begin = job.next.fetch_add(job.grain);
+    if (begin >= job.count) {
+      break;
+    }
+    size_t end = std::min(begin + job.grain, job.count);
+    job.function(job.context, begin, end);
+  }
+}
+
+class ThreadPool {
+public:
+  ThreadPool() : current(nullptr), generation(0), busyWorkers(0),
+                 stopping(false) {
+    unsigned hardware = std::thread::hardware_concurrency();
+    size_t workers = hardware > 1 ? hardware - 1 : 0;
+    for (size_t i = 0; i < workers; ++i) {
+      threads.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+  }
+
+  size_t threadCount() const { return threads.size() + 1; }
+
+  // Only one thread may drive the pool at a time
+  std::mutex submitMutex;
+
+  void run(Job &job) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      current = &job;
+      busyWorkers = threads.size();
+      ++generation;
+    }
+    wake.notify_all();
+
+    insideJob = true;
+    runChunks(job);
+    insideJob = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    current = nullptr;
+  }
+
+private:
+  void workerLoop(size_t index) {
+    threadIndex = index;
+    insideJob = true;
+    size_t seen = 0;
+    for (;;) {
+      Job *job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping) {
+          return;
+        }
+        seen = generation;
+        job = current;
+      }
+      runChunks(*job);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0) {
+          done.notify_one();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  Job *current;
+  size_t generation;
+  size_t busyWorkers;
+  bool stopping;
+};
+
+ThreadPool &pool() {
+  static ThreadPool instance;
+  return instance;
+}
+
+} // namespace
+
+void parallelForRange(size_t count, size_t grain, RangeFunction function,
+                      void *context) {
+  if (count == 0) {
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+
+  ThreadPool &threads = pool();
+  bool serial = insideJob || count <= grain || threads.threadCount() == 1;
+  std::unique_lock<std::mutex> owner(threads.submitMutex, std::defer_lock);
+  if (serial || !owner.try_lock()) {
+    function(context, 0, count);
+    return;
+  }
+
+  Job job;
+  job.function = function;
+  job.context = context;
+  job.count = count;
+  job.grain = grain;
+  job.next.store(0);
+  threads.run(job);
+}
+
+size_t parallelThreadCount() { return pool().threadCount(); }
+
+size_t parallelThreadIndex() { return threadIndex; }
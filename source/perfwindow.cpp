@@ -0,0 +1,70 @@
+#include "perfwindow.h"
+#include "imgui.h"
+#include <cfloat>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+
+PerfWindow::PerfWindow() : head(0) {
+  for (int series = 0; series < SeriesCount; ++series) {
+    for (int i = 0; i < historyLength; ++i) {
+      history[series][i] = 0.0f;
+    }
+  }
+  statmFile = open("/proc/self/statm", O_RDONLY);
+  pageSize = sysconf(_SC_PAGESIZE);
+}
+
+PerfWindow::~PerfWindow() {
+  if (statmFile >= 0) {
+    close(statmFile);
+  }
+}
+
+double PerfWindow::residentMegabytes() {
+  char text[128];
+  ssize_t length =
+      statmFile >= 0 ? pread(statmFile, text, sizeof(text) - 1, 0) : -1;
+  if (length <= 0) {
+    return 0.0;
+  }
+  text[length] = '\0';
+
+  // Total program size, then resident pages
+  unsigned long size = 0, resident = 0;
+  if (sscanf(text, "%lu %lu", &size, &resident) != 2) {
+    return 0.0;
+  }
+  return resident * (double)pageSize / (1024.0 * 1024.0);
+}
+
+void PerfWindow::addFrame(const PerfFrame &frame) {
+  history[SeriesFrame][head] = frame.frameMilliseconds;
+  history[SeriesPhysics][head] = frame.physicsMilliseconds;
+  history[SeriesPairs][head] = frame.pairs;
+  history[SeriesContacts][head] = frame.contacts;
+  history[SeriesDrawCalls][head] = frame.drawCalls;
+  history[SeriesTriangles][head] = frame.triangles;
+  history[SeriesMemory][head] = residentMegabytes();
+  head = (head + 1) % historyLength;
+}
+
+void PerfWindow::draw() {
+  static const char *labels[SeriesCount] = {
+      "Frame",      "Physics",   "Pairs", "Contacts",
+      "Draw calls", "Triangles", "Memory"};
+  static const char *formats[SeriesCount] = {
+      "%.2f ms", "%.2f ms", "%.0f", "%.0f", "%.0f", "%.0f", "%.1f MB"};
+
+  ImGui::Begin("Performance");
+  int newest = (head + historyLength - 1) % historyLength;
+  for (int series = 0; series < SeriesCount; ++series) {
+    char overlay[32];
+    snprintf(overlay, sizeof(overlay), formats[series],
+             history[series][newest]);
+    // Scaled to the largest sample on screen
+    ImGui::PlotLines(labels[series], history[series], historyLength, head,
+                     overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+  }
+  ImGui::End();
+}
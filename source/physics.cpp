@@ -1,99 +1,96 @@
 #include "physics.h"
+#ifdef BAKED_MESH
+#include "bakedmesh.h"
+#endif
 #include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <vector>
 
 using namespace std;
 Sphere::Sphere(float radius, int sectors, int stacks)
-    : radius(radius), sectors(sectors), stacks(stacks) {
+    : radius(radius), shape(SphereUV), sectors(sectors), stacks(stacks),
+      textureID(0), indexCount(0) {
 
   generateSphere();
 }
 
-Sphere::~Sphere() {
-  glDeleteBuffers(1, &vertexBuffer);
-  glDeleteBuffers(1, &colorBuffer);
-  glDeleteBuffers(1, &indexBuffer);
-  glDeleteBuffers(1, &textureBuffer);
-  glDeleteVertexArrays(1, &vertexArrayID);
+Sphere::Sphere(SphereShape shape, float radius, int detail)
+    : radius(radius), shape(shape), sectors(detail), stacks(0), textureID(0),
+      indexCount(0) {
+  generateSphere();
+}
+
+void Sphere::setRadius(float newRadius) {
+  radius = newRadius;
+  generateVertices();
+
+  // Same tessellation, so the vertex count and buffer size are unchanged
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+  glBufferSubData(GL_ARRAY_BUFFER, 0, mesh.vertices.size() * sizeof(GLfloat),
+                  mesh.vertices.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 void Sphere::generateSphere() {
+#ifdef BAKED_MESH
+  // The compiler already built this one, upload it straight from .rodata
+  if (shape == SphereUV && radius == 1.0f && sectors == 36 && stacks == 18) {
+    const auto &baked = bakedBallSphere;
+    uploadGeometry(baked.vertices.data(), baked.colors.data(),
+                   baked.textureCoords.data(), baked.vertexCount,
+                   baked.indices.data(), baked.indexCount);
+    return;
+  }
+#endif
   generateVertices();
   generateColors();
   generateIndices();
+  uploadGeometry(mesh.vertices.data(), mesh.colors.data(),
+                 mesh.textureCoords.data(), mesh.vertices.size() / 3,
+                 mesh.indices.data(), mesh.indices.size());
+}
+
+void Sphere::uploadGeometry(const float *vertices, const float *colors,
+                            const float *textureCoords, size_t vertexCount,
+                            const unsigned int *indices, size_t indexCount) {
+  this->indexCount = (GLsizei)indexCount;
 
-  glGenVertexArrays(1, &vertexArrayID);
-  glBindVertexArray(vertexArrayID);
+  vertexArray = GLVertexArray::create();
+  glBindVertexArray(vertexArray.get());
 
-  glGenBuffers(1, &vertexBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
-  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0],
+  vertexBuffer = GLBuffer::create();
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(GLfloat), vertices,
                GL_STATIC_DRAW);
 
-  glGenBuffers(1, &colorBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
-  glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(GLfloat), &colors[0],
+  colorBuffer = GLBuffer::create();
+  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer.get());
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * 3 * sizeof(GLfloat), colors,
                GL_STATIC_DRAW);
 
-  glGenBuffers(1, &indexBuffer);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
-               &indices[0], GL_STATIC_DRAW);
+  indexBuffer = GLBuffer::create();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(GLuint), indices,
+               GL_STATIC_DRAW);
 
-  glGenBuffers(1, &textureBuffer);
-  glBindBuffer(GL_ARRAY_BUFFER, textureBuffer);
-  glBufferData(GL_ARRAY_BUFFER, textureCoords.size() * sizeof(float),
-               textureCoords.data(), GL_STATIC_DRAW);
+  textureBuffer = GLBuffer::create();
+  glBindBuffer(GL_ARRAY_BUFFER, textureBuffer.get());
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * 2 * sizeof(float),
+               textureCoords, GL_STATIC_DRAW);
 }
 
 void Sphere::generateVertices() {
-  float x, y, z, xy;                           // Vertex position (x, y, z)
-  float nx, ny, nz, lengthInv = 1.0f / radius; // Normalized vertex
-  float sectorStep = 2 * M_PI / sectors;       // Angle step
-  float stackStep = M_PI / stacks;             // Angle step
-
-  // Loop through the stacks
-  for (int i = 0; i <= stacks; ++i) {
-    float stackAngle = M_PI / 2 - i * stackStep; // Current angle
-    xy = radius * cosf(stackAngle);              // Projected radius
-    z = radius * sinf(stackAngle);               // Z position
-
-    // Loop through the sectors
-    for (int j = 0; j <= sectors; ++j) {
-      float sectorAngle = j * sectorStep; // Current angle
-
-      // Calculate position
-      x = xy * cosf(sectorAngle); // X position
-      y = xy * sinf(sectorAngle); // Y position
-
-      // Normalized vertex
-      nx = x * lengthInv;
-      ny = y * lengthInv;
-      nz = z * lengthInv;
-
-      // Compute texture coordinates (UV mapping)
-      float u = (float)j / sectors; // U coordinate
-      float v = (float)i / stacks;  // V coordinate
-
-      // Add vertex data
-      vertices.push_back(x);
-      vertices.push_back(y);
-      vertices.push_back(z);
-
-      // Add normal data (optional, if using lighting)
-      // normals.push_back(nx);
-      // normals.push_back(ny);
-      // normals.push_back(nz);
-
-      // Add color data (optional)
-      colors.push_back(0.5f + 0.5f * nx);
-      colors.push_back(0.5f + 0.5f * ny);
-      colors.push_back(0.5f + 0.5f * nz);
-
-      // Add texture coordinates
-      textureCoords.push_back(u);
-      textureCoords.push_back(v);
-    }
+  // The icosphere and cube sphere generate their indices with the vertices,
+  // already in vertex cache order
+  switch (shape) {
+  case SphereIcosphere:
+    generateIcosphere(radius, sectors, mesh);
+    break;
+  case SphereCubeSphere:
+    generateCubeSphere(radius, sectors, mesh);
+    break;
+  default:
+    generateSphereVertices(radius, sectors, stacks, mesh);
   }
 }
 
@@ -102,19 +99,8 @@ void Sphere::generateColors() {
 }
 
 void Sphere::generateIndices() {
-  // Loop through the stacks and sectors to create the indices
-  for (int i = 0; i < stacks; ++i) {
-    for (int j = 0; j < sectors; ++j) {
-      int first = i * (sectors + 1) + j;
-      int second = first + sectors + 1;
-      indices.push_back(first);
-      indices.push_back(second);
-      indices.push_back(first + 1);
-
-      indices.push_back(second);
-      indices.push_back(second + 1);
-      indices.push_back(first + 1);
-    }
+  if (shape == SphereUV) {
+    generateSphereIndices(sectors, stacks, mesh);
   }
 }
 
@@ -160,36 +146,70 @@ void Sphere::setTexture(GLuint textureID) { this->textureID = textureID; }
 void Sphere::draw(GLuint programID, GLuint MatrixID, const glm::mat4 &MVP) {
   glUseProgram(programID);
   glUniformMatrix4fv(MatrixID, 1, GL_FALSE, &MVP[0][0]);
-  glUniform1i(glGetUniformLocation(programID, "isGround"),
-              0); // Use texture for spheres
-  glBindVertexArray(vertexArrayID);
+  glBindVertexArray(vertexArray.get());
 
   // Position attribute
-  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
 
   // Color attribute (optional, remove if using textures fully)
-  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, colorBuffer.get());
   glEnableVertexAttribArray(1);
   glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
 
   // Texture coordinates attribute
-  glBindBuffer(GL_ARRAY_BUFFER, textureBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, textureBuffer.get());
   glEnableVertexAttribArray(2);
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
 
   // Bind texture
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, textureID);
-  glUniform1i(glGetUniformLocation(programID, "texture1"), 0);
+  glUniform1i(glGetUniformLocation(programID, "textureSampler"), 0);
 
   // Draw sphere
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, (void *)0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+  glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, (void *)0);
 
   // Cleanup
   glDisableVertexAttribArray(0);
   glDisableVertexAttribArray(1);
   glDisableVertexAttribArray(2);
 }
+
+void Sphere::drawInstanced(GLuint instanceBuffer, GLsizei count) {
+  glBindVertexArray(vertexArray.get());
+
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.get());
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void *)0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, textureBuffer.get());
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void *)0);
+
+  // A mat4 attribute takes one location per column
+  glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+  for (int column = 0; column < 4; ++column) {
+    glEnableVertexAttribArray(3 + column);
+    glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(SphereInstance),
+                          (void *)(offsetof(SphereInstance, mvp) +
+                                   column * sizeof(glm::vec4)));
+    glVertexAttribDivisor(3 + column, 1);
+  }
+  glEnableVertexAttribArray(7);
+  glVertexAttribPointer(7, 1, GL_FLOAT, GL_FALSE, sizeof(SphereInstance),
+                        (void *)offsetof(SphereInstance, layer));
+  glVertexAttribDivisor(7, 1);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.get());
+  glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT,
+                          (void *)0, count);
+
+  // Cleanup
+  for (int location = 0; location < 8; ++location) {
+    glDisableVertexAttribArray(location);
+  }
+}
@@ -0,0 +1,188 @@
+#include "profiler.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+thread_local uint32_t ProfileScope::currentDepth = 0;
+
+namespace {
+
+struct ProfileEvent {
+  const char *name;
+  uint64_t start;
+  uint64_t end;
+  uint32_t depth;
+};
+
+// Single producer (the owning thread), single consumer (the collector).
+// Sized for the zones of one frame, collection empties it every frame.
+struct ProfileRing {
+  static const size_t capacity = 1 << 16;
+
+  ProfileEvent events[capacity];
+  std::atomic<size_t> head{0};
+  std::atomic<size_t> tail{0};
+  std::atomic<uint64_t> dropped{0};
+  uint32_t threadId = 0;
+  const char *threadName = nullptr;
+  bool nanoseconds = false; // Track rings hold profilerElapsedNs() times
+
+  // Consumer side, under ringsMutex
+  std::vector<ProfileEvent> collected;
+  uint64_t droppedTotal = 0;
+};
+
+std::mutex ringsMutex;
+std::vector<ProfileRing *> rings;
+
+// Reference point to turn ticks into steady_clock time at export
+const uint64_t baseTicks = profilerNow();
+const std::chrono::steady_clock::time_point baseTime =
+    std::chrono::steady_clock::now();
+
+thread_local ProfileRing *threadRing = nullptr;
+
+// Registration takes the lock once per thread, recording never does
+ProfileRing &ring() {
+  if (!threadRing) {
+    ProfileRing *created = new ProfileRing();
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    created->threadId = rings.size() + 1;
+    rings.push_back(created);
+    threadRing = created;
+  }
+  return *threadRing;
+}
+
+void push(ProfileRing &buffer, const char *name, uint64_t start,
+          uint64_t end, uint32_t depth) {
+  size_t head = buffer.head.load(std::memory_order_relaxed);
+  if (head - buffer.tail.load(std::memory_order_acquire) >=
+      ProfileRing::capacity) {
+    buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ProfileEvent &event = buffer.events[head & (ProfileRing::capacity - 1)];
+  event.name = name;
+  event.start = start;
+  event.end = end;
+  event.depth = depth;
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+// Move the ring's zones out to its collected buffer
+void collect(ProfileRing &buffer) {
+  size_t tail = buffer.tail.load(std::memory_order_relaxed);
+  size_t head = buffer.head.load(std::memory_order_acquire);
+  for (; tail != head; ++tail) {
+    buffer.collected.push_back(
+        buffer.events[tail & (ProfileRing::capacity - 1)]);
+  }
+  buffer.tail.store(head, std::memory_order_release);
+  buffer.droppedTotal +=
+      buffer.dropped.exchange(0, std::memory_order_relaxed);
+}
+
+} // namespace
+
+struct ProfileTrack {
+  ProfileRing ring;
+};
+
+ProfileTrack *profilerTrack(const char *name) {
+  ProfileTrack *created = new ProfileTrack();
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  created->ring.threadId = rings.size() + 1;
+  created->ring.threadName = name;
+  created->ring.nanoseconds = true;
+  rings.push_back(&created->ring);
+  return created;
+}
+
+void profilerRecord(const char *name, uint64_t start, uint64_t end,
+                    uint32_t depth) {
+  push(ring(), name, start, end, depth);
+}
+
+void profilerRecordTrack(ProfileTrack *track, const char *name,
+                         uint64_t startNs, uint64_t endNs) {
+  push(track->ring, name, startNs, endNs, 0);
+}
+
+uint64_t profilerElapsedNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - baseTime)
+      .count();
+}
+
+void profilerSetThreadName(const char *name) { ring().threadName = name; }
+
+void profilerCollect() {
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  for (ProfileRing *buffer : rings) {
+    collect(*buffer);
+  }
+}
+
+bool profilerWriteChromeTrace(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  // Tick rate measured over the whole run, exact for steady_clock ticks
+  uint64_t nowTicks = profilerNow();
+  double elapsedNs = std::chrono::duration<double, std::nano>(
+                         std::chrono::steady_clock::now() - baseTime)
+                         .count();
+  double nsPerTick =
+      nowTicks > baseTicks ? elapsedNs / double(nowTicks - baseTicks) : 1.0;
+
+  std::lock_guard<std::mutex> lock(ringsMutex);
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+  bool first = true;
+  uint64_t dropped = 0;
+  for (ProfileRing *buffer : rings) {
+    if (buffer->threadName) {
+      fprintf(file,
+              "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+              "\"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+              first ? "" : ",", buffer->threadId, buffer->threadName);
+      first = false;
+    }
+
+    collect(*buffer);
+    for (const ProfileEvent &event : buffer->collected) {
+      double startUs, durationUs;
+      if (buffer->nanoseconds) {
+        startUs = event.start * 1e-3;
+        durationUs = (event.end - event.start) * 1e-3;
+      } else {
+        startUs = (event.start - baseTicks) * nsPerTick * 1e-3;
+        durationUs = (event.end - event.start) * nsPerTick * 1e-3;
+      }
+      fprintf(file,
+              "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+              "\"ts\": %.3f, \"dur\": %.3f, \"args\": {\"depth\": %u}}",
+              first ? "" : ",", event.name, buffer->threadId, startUs,
+              durationUs, event.depth);
+      first = false;
+    }
+    buffer->collected.clear();
+
+    if (buffer->droppedTotal > 0) {
+      std::cerr << "Profiler: thread " << buffer->threadId << " dropped "
+                << buffer->droppedTotal << " zones, its buffer was full"
+                << std::endl;
+      dropped += buffer->droppedTotal;
+      buffer->droppedTotal = 0;
+    }
+  }
+  fprintf(file, "\n], \"otherData\": {\"droppedZones\": %llu}}\n",
+          static_cast<unsigned long long>(dropped));
+  return fclose(file) == 0;
+}
@@ -0,0 +1,150 @@
+#include "programcache.h"
+#include "shaders.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+const char *programCacheDirectory = "shadercache";
+
+// Written ahead of the binary. The key is repeated so a hash collision in
+// the file name cannot load the wrong program.
+struct ProgramCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format;
+  uint32_t length;
+};
+
+static const char programCacheMagic[4] = {'P', 'B', 'I', 'N'};
+static const uint32_t programCacheVersion = 1;
+
+uint64_t fnv1a(const void *data, size_t size, uint64_t hash) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+static uint64_t hashString(const char *text, uint64_t hash) {
+  // The terminator separates fields, so "ab"+"c" differs from "a"+"bc"
+  return fnv1a(text ? text : "", text ? strlen(text) + 1 : 1, hash);
+}
+
+static uint64_t programKey(const char *vertexCode, const char *fragmentCode) {
+  uint64_t hash = hashString(vertexCode, fnvOffsetBasis);
+  hash = hashString(fragmentCode, hash);
+  GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+  for (GLenum name : strings) {
+    hash = hashString(
+        reinterpret_cast<const char *>(glGetString(name)), hash);
+  }
+  return hash;
+}
+
+static std::string entryPath(uint64_t key) {
+  char name[32];
+  snprintf(name, sizeof(name), "/%016llx.bin", (unsigned long long)key);
+  return programCacheDirectory + std::string(name);
+}
+
+static GLuint loadEntry(uint64_t key) {
+  std::ifstream file(entryPath(key), std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    return 0;
+  }
+  ProgramCacheHeader header;
+  if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) !=
+          0 ||
+      header.version != programCacheVersion || header.key != key) {
+    return 0;
+  }
+  // The length must be what is left of the file, or a corrupt header could
+  // ask for gigabytes before the read fails
+  std::streamoff offset = file.tellg();
+  file.seekg(0, std::ios::end);
+  std::streamoff size = file.tellg();
+  if (offset < 0 || size - offset != std::streamoff(header.length)) {
+    return 0;
+  }
+  file.seekg(offset);
+  std::vector<char> binary(header.length);
+  if (!file.read(binary.data(), binary.size())) {
+    return 0;
+  }
+
+  // The driver may still reject it, after an update that kept the version
+  // string for example
+  GLuint program = glCreateProgram();
+  glProgramBinary(program, header.format, binary.data(), header.length);
+  GLint linked = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked != GL_TRUE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+static void storeEntry(uint64_t key, GLuint program) {
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+  std::vector<char> binary(length);
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  ProgramCacheHeader header;
+  memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+  header.version = programCacheVersion;
+  header.key = key;
+  header.format = format;
+  header.length = length;
+
+  // Written aside and renamed, so runs started together never read a
+  // partial entry
+  mkdir(programCacheDirectory, 0755);
+  std::string path = entryPath(key);
+  std::string temporary = path + "." + std::to_string(getpid()) + ".tmp";
+  std::ofstream file(temporary, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << temporary << std::endl;
+    return;
+  }
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.write(binary.data(), length);
+  file.close();
+  if (!file.good() || rename(temporary.c_str(), path.c_str()) != 0) {
+    std::cerr << "Error: Cannot write " << path << std::endl;
+    unlink(temporary.c_str());
+  }
+}
+
+GLuint LoadProgram(const char *vertexCode, const char *fragmentCode,
+                   const char *vertexName, const char *fragmentName) {
+  if (!GLEW_ARB_get_program_binary) {
+    return BuildProgram(vertexCode, fragmentCode, vertexName, fragmentName);
+  }
+
+  uint64_t key = programKey(vertexCode, fragmentCode);
+  GLuint program = loadEntry(key);
+  if (program != 0) {
+    return program;
+  }
+
+  program = BuildProgram(vertexCode, fragmentCode, vertexName, fragmentName);
+  if (program != 0) {
+    storeEntry(key, program);
+  }
+  return program;
+}
@@ -0,0 +1,288 @@
+#include "scene.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char sceneMagic[4] = {'E', 'C', 'S', 'B'};
+static const uint32_t sceneVersion = 3;
+static const size_t sceneAlignment = 64;
+
+struct SceneFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t bodyCount;
+  uint64_t seed;
+  uint64_t stride; // Bytes between the start of two consecutive arrays
+  float gravity;
+  float groundY;
+  float damping;
+  unsigned char padding[sceneAlignment - 44];
+};
+static_assert(sizeof(SceneFileHeader) == sceneAlignment,
+              "Scene header must keep the arrays aligned");
+
+// State arrays in SceneArray order
+static std::vector<float> SimulationState::*const sceneArrays[] = {
+    &SimulationState::posX, &SimulationState::posY, &SimulationState::posZ,
+    &SimulationState::velX, &SimulationState::velY, &SimulationState::velZ,
+    &SimulationState::radius};
+static_assert(sizeof(sceneArrays) / sizeof(sceneArrays[0]) == SceneArrayCount,
+              "One state array per SceneArray");
+
+static size_t arrayStride(size_t bodyCount) {
+  size_t bytes = bodyCount * sizeof(float);
+  return (bytes + sceneAlignment - 1) / sceneAlignment * sceneAlignment;
+}
+
+MappedScene::MappedScene()
+    : mapping(nullptr), mappingSize(0), count(0), stride(0), rngSeed(0),
+      sceneGravity(0.0f), sceneGroundY(0.0f), sceneDamping(0.0f) {}
+
+MappedScene::~MappedScene() { close(); }
+
+bool MappedScene::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      static_cast<size_t>(info.st_size) < sizeof(SceneFileHeader)) {
+    std::cerr << "Error: " << path << " is not a binary scene" << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  // Fault the pages in up front, the arrays are about to be read in full
+  size_t size = info.st_size;
+  void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    std::cerr << "Error: Cannot map " << path << std::endl;
+    return false;
+  }
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  SceneFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, sceneMagic, sizeof(sceneMagic)) != 0 ||
+      header.version != sceneVersion ||
+      header.bodyCount > size / sizeof(float) ||
+      header.stride != arrayStride(header.bodyCount) ||
+      !validDamping(header.damping) ||
+      (size - sizeof(header)) / SceneArrayCount < header.stride) {
+    std::cerr << "Error: " << path << " is not a valid binary scene"
+              << std::endl;
+    munmap(data, size);
+    return false;
+  }
+
+  mapping = data;
+  mappingSize = size;
+  count = header.bodyCount;
+  stride = header.stride;
+
+  // Same rule as the text loader, one pass over pages just faulted in
+  for (int which = 0; which < SceneArrayCount; ++which) {
+    const float *values = array(static_cast<SceneArray>(which));
+    for (size_t i = 0; i < count; ++i) {
+      if (which == SceneRadius ? !validRadius(values[i])
+                               : !std::isfinite(values[i])) {
+        std::cerr << "Error: " << path << ": sphere " << i
+                  << " has an invalid position, velocity or radius"
+                  << std::endl;
+        close();
+        return false;
+      }
+    }
+  }
+  rngSeed = header.seed;
+  sceneGravity = header.gravity;
+  sceneGroundY = header.groundY;
+  sceneDamping = header.damping;
+  return true;
+}
+
+void MappedScene::close() {
+  if (mapping) {
+    munmap(mapping, mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+  count = 0;
+  stride = 0;
+  rngSeed = 0;
+}
+
+const float *MappedScene::array(SceneArray which) const {
+  const unsigned char *base = static_cast<const unsigned char *>(mapping);
+  return reinterpret_cast<const float *>(base + sizeof(SceneFileHeader) +
+                                         which * stride);
+}
+
+bool loadSceneBinary(SimulationState &state, const char *path,
+                     uint64_t *seed) {
+  MappedScene scene;
+  if (!scene.open(path)) {
+    return false;
+  }
+
+  // The mapped arrays already have the in-memory layout, this is one bulk
+  // copy per array
+  size_t count = scene.bodyCount();
+  state.clear();
+  for (int i = 0; i < SceneArrayCount; ++i) {
+    const float *source = scene.array(static_cast<SceneArray>(i));
+    (state.*sceneArrays[i]).assign(source, source + count);
+  }
+  state.rotation.assign(count, 0.0f);
+  state.sleepTimer.assign(count, 0.0f);
+  state.awake.assign(count, 1);
+  state.island.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    state.island[i] = uint32_t(i);
+  }
+  state.gravity = scene.gravity();
+  state.groundY = scene.groundY();
+  state.damping = scene.damping();
+  state.rng.seed(scene.seed());
+  if (seed) {
+    *seed = scene.seed();
+  }
+  return true;
+}
+
+bool loadSceneText(SimulationState &state, const char *path,
+                   uint64_t *seed) {
+  std::ifstream file(path, std::ios::in);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  SimulationState loaded;
+  uint64_t sceneSeed = std::mt19937_64::default_seed;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(file, line)) {
+    ++lineNumber;
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream words(line);
+    std::string directive;
+    if (!(words >> directive)) {
+      continue; // Blank line
+    }
+
+    bool valid = false;
+    if (directive == "sphere") {
+      float x, y, z, vx, vy, vz, r;
+      valid = static_cast<bool>(words >> x >> y >> z >> vx >> vy >> vz >> r);
+      if (valid) {
+        valid = validBody(loaded, loaded.addBody(x, y, z, vx, vy, vz, r));
+      }
+    } else if (directive == "seed") {
+      valid = static_cast<bool>(words >> sceneSeed);
+    } else if (directive == "gravity") {
+      valid = static_cast<bool>(words >> loaded.gravity);
+    } else if (directive == "ground") {
+      valid = static_cast<bool>(words >> loaded.groundY);
+    } else if (directive == "damping") {
+      valid = words >> loaded.damping && validDamping(loaded.damping);
+    }
+    if (!valid) {
+      std::cerr << "Error: " << path << ":" << lineNumber
+                << ": cannot parse '" << line << "'" << std::endl;
+      return false;
+    }
+  }
+
+  loaded.rng.seed(sceneSeed);
+  state = std::move(loaded);
+  if (seed) {
+    *seed = sceneSeed;
+  }
+  return true;
+}
+
+bool saveSceneText(const SimulationState &state, uint64_t seed,
+                   const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  // %.9g round-trips every float exactly
+  fprintf(file, "seed %llu\n", static_cast<unsigned long long>(seed));
+  fprintf(file, "gravity %.9g\nground %.9g\n", state.gravity, state.groundY);
+  if (state.damping != 0.0f) {
+    fprintf(file, "damping %.9g\n", state.damping);
+  }
+  for (size_t i = 0; i < state.size(); ++i) {
+    fprintf(file, "sphere %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", state.posX[i],
+            state.posY[i], state.posZ[i], state.velX[i], state.velY[i],
+            state.velZ[i], state.radius[i]);
+  }
+  return fclose(file) == 0;
+}
+
+bool saveSceneBinary(const SimulationState &state, uint64_t seed,
+                     const char *path) {
+  std::ofstream file(path, std::ios::out | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+
+  SceneFileHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, sceneMagic, sizeof(sceneMagic));
+  header.version = sceneVersion;
+  header.bodyCount = state.size();
+  header.seed = seed;
+  header.stride = arrayStride(state.size());
+  header.gravity = state.gravity;
+  header.groundY = state.groundY;
+  header.damping = state.damping;
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+  static const char zeros[sceneAlignment] = {};
+  size_t bytes = state.size() * sizeof(float);
+  for (auto member : sceneArrays) {
+    const std::vector<float> &array = state.*member;
+    file.write(reinterpret_cast<const char *>(array.data()), bytes);
+    file.write(zeros, header.stride - bytes);
+  }
+  return file.good();
+}
+
+bool loadScene(SimulationState &state, const char *path, uint64_t *seed) {
+  char magic[sizeof(sceneMagic)] = {};
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  if (!file.is_open()) {
+    std::cerr << "Error: Cannot open " << path << std::endl;
+    return false;
+  }
+  file.read(magic, sizeof(magic));
+  file.close();
+
+  if (memcmp(magic, sceneMagic, sizeof(sceneMagic)) == 0) {
+    return loadSceneBinary(state, path, seed);
+  }
+  return loadSceneText(state, path, seed);
+}
@@ -0,0 +1,245 @@
+#include "scenegen.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+static const size_t generateGrain = 4096;
+
+// Counter based random numbers: hashing (seed, index, stream) gives every
+// body its own reproducible values independent of generation order
+static uint64_t splitMix64(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+// Uniform float in [0, 1)
+static float randomFloat(uint64_t seed, size_t index, uint64_t stream) {
+  uint64_t bits = splitMix64(seed ^ splitMix64(index * 4 + stream));
+  return (bits >> 40) * (1.0f / 16777216.0f);
+}
+
+// Uniform float in [-1, 1)
+static float randomSigned(uint64_t seed, size_t index, uint64_t stream) {
+  return randomFloat(seed, index, stream) * 2.0f - 1.0f;
+}
+
+static void prepare(SimulationState &state, size_t count, uint64_t seed,
+                    float gravity) {
+  state.clear();
+  state.resize(count);
+  state.gravity = gravity;
+  state.groundY = -3.0f;
+  state.damping = 0.0f;
+  state.rng.seed(seed);
+}
+
+// Smallest side such that side^3 >= count
+static size_t cubeSide(size_t count) {
+  size_t side = static_cast<size_t>(std::cbrt(static_cast<double>(count)));
+  while (side * side * side < count) {
+    ++side;
+  }
+  return side > 0 ? side : 1;
+}
+
+void generateLattice(SimulationState &state, size_t count, uint64_t seed) {
+  prepare(state, count, seed, 0.0f);
+
+  const float radius = 0.5f;
+  const float spacing = 2.5f * radius;
+  size_t side = cubeSide(count);
+  float offset = (side - 1) * spacing * 0.5f;
+
+  parallelFor(count, generateGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      size_t ix = i % side;
+      size_t iy = (i / side) % side;
+      size_t iz = i / (side * side);
+      state.posX[i] = ix * spacing - offset;
+      state.posY[i] = state.groundY + radius + iy * spacing;
+      state.posZ[i] = iz * spacing - offset;
+      state.velX[i] = randomSigned(seed, i, 0);
+      state.velY[i] = randomSigned(seed, i, 1);
+      state.velZ[i] = randomSigned(seed, i, 2);
+      state.radius[i] = radius;
+    }
+  });
+}
+
+void generateGas(SimulationState &state, size_t count, uint64_t seed) {
+  prepare(state, count, seed, 0.0f);
+
+  const float minRadius = 0.2f;
+  const float maxRadius = 0.5f;
+  const float cell = 2.0f * maxRadius * 1.05f;
+  size_t side = cubeSide(count);
+  float offset = (side - 1) * cell * 0.5f;
+
+  parallelFor(count, generateGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      float radius =
+          minRadius + (maxRadius - minRadius) * randomFloat(seed, i, 3);
+
+      // Staying within cell / 2 - radius of the cell centre keeps every pair
+      // of neighbours at least the sum of their radii apart
+      float jitter = cell * 0.5f - radius;
+      size_t ix = i % side;
+      size_t iy = (i / side) % side;
+      size_t iz = i / (side * side);
+      state.posX[i] = ix * cell - offset + jitter * randomSigned(seed, i, 0);
+      state.posY[i] = state.groundY + cell * 0.5f + iy * cell +
+                      jitter * randomSigned(seed, i, 1);
+      state.posZ[i] = iz * cell - offset + jitter * randomSigned(seed, i, 2);
+      state.velX[i] = 2.0f * randomSigned(seed, i + count, 0);
+      state.velY[i] = 2.0f * randomSigned(seed, i + count, 1);
+      state.velZ[i] = 2.0f * randomSigned(seed, i + count, 2);
+      state.radius[i] = radius;
+    }
+  });
+}
+
+void generatePile(SimulationState &state, size_t count, uint64_t seed) {
+  prepare(state, count, seed, 9.81f);
+  // Contacts are elastic and frictionless, without drag the pile would
+  // bounce apart into a gas and never sleep
+  state.damping = 0.5f;
+
+  // A square pyramid with every layer in the pockets of the one below, so
+  // it starts out packed and at rest. Frictionless spheres cannot hold it
+  // up; it slumps, with thousands of contacts, into a layer that sleeps.
+  // Layer k has (base - k)^2 spheres, the top one may be partial.
+  const float radius = 0.5f;
+  const float spacing = 2.0f * radius;
+  const float layerHeight = 1.41421356f * radius; // sqrt(2) * radius
+  std::vector<size_t> layerStart(1, 0);
+  size_t base = 1;
+  while (base * (base + 1) * (2 * base + 1) / 6 < count) {
+    ++base;
+  }
+  for (size_t side = base; layerStart.back() < count; --side) {
+    layerStart.push_back(layerStart.back() + side * side);
+  }
+  float offset = (base - 1) * spacing * 0.5f;
+
+  parallelFor(count, generateGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      auto above = std::upper_bound(layerStart.begin(), layerStart.end(), i);
+      size_t layer = above - layerStart.begin() - 1;
+      size_t side = base - layer;
+      size_t inLayer = i - layerStart[layer];
+      // Each layer is shifted half a spacing to sit in the pockets
+      float shift = layer * spacing * 0.5f;
+      state.posX[i] = (inLayer % side) * spacing + shift - offset;
+      state.posY[i] = state.groundY + radius + layer * layerHeight;
+      state.posZ[i] = (inLayer / side) * spacing + shift - offset;
+      state.velX[i] = 0.0f;
+      state.velY[i] = 0.0f;
+      state.velZ[i] = 0.0f;
+      state.radius[i] = radius;
+    }
+  });
+}
+
+void generateCradles(SimulationState &state, size_t count, uint64_t seed) {
+  prepare(state, count, seed, 0.0f);
+
+  // The striker starts one diameter away from the four resting balls
+  const size_t chainLength = 5;
+  const float radius = 0.5f;
+  const float chainSpan = (chainLength + 3) * 2.0f * radius;
+  const float rowSpacing = 3.0f * radius;
+  size_t chains = (count + chainLength - 1) / chainLength;
+  size_t perRow = static_cast<size_t>(std::ceil(std::sqrt(double(chains))));
+  if (perRow == 0) {
+    perRow = 1;
+  }
+  float offsetX = perRow * chainSpan * 0.5f;
+  float offsetZ = (chains / perRow) * rowSpacing * 0.5f;
+
+  parallelFor(count, generateGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      size_t chain = i / chainLength;
+      size_t ball = i % chainLength;
+      float startX = (chain % perRow) * chainSpan - offsetX;
+      float gap = ball == 0 ? 0.0f : 2.0f * radius;
+      state.posX[i] = startX + gap + ball * 2.0f * radius;
+      state.posY[i] = state.groundY + radius;
+      state.posZ[i] = (chain / perRow) * rowSpacing - offsetZ;
+      state.velX[i] =
+          ball == 0 ? 1.5f + 0.5f * randomFloat(seed, chain, 0) : 0.0f;
+      state.velY[i] = 0.0f;
+      state.velZ[i] = 0.0f;
+      state.radius[i] = radius;
+    }
+  });
+}
+
+void generateBilliards(SimulationState &state, size_t count, uint64_t seed) {
+  prepare(state, count, seed, 0.0f);
+  if (count == 0) {
+    return;
+  }
+
+  // Racked balls are a hair apart so they start out not touching
+  const float radius = 0.5f;
+  const float spacing = 2.0f * radius * 1.001f;
+  const float rowStep = spacing * 0.8660254f; // sqrt(3) / 2
+  size_t racked = count - 1;
+  size_t rows = static_cast<size_t>(
+      std::ceil((std::sqrt(8.0 * racked + 1.0) - 1.0) * 0.5));
+
+  parallelFor(racked, generateGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      size_t row =
+          static_cast<size_t>((std::sqrt(8.0 * i + 1.0) - 1.0) * 0.5);
+      // Guard against rounding at the row boundaries
+      while (row * (row + 1) / 2 > i) {
+        --row;
+      }
+      while ((row + 1) * (row + 2) / 2 <= i) {
+        ++row;
+      }
+      size_t column = i - row * (row + 1) / 2;
+      state.posX[i] = row * rowStep;
+      state.posY[i] = state.groundY + radius;
+      state.posZ[i] = (column - row * 0.5f) * spacing;
+      state.velX[i] = 0.0f;
+      state.velY[i] = 0.0f;
+      state.velZ[i] = 0.0f;
+      state.radius[i] = radius;
+    }
+  });
+
+  // Cue ball, slightly off centre so the break isn't perfectly symmetric
+  size_t cue = count - 1;
+  float distance = 10.0f + rows * rowStep * 0.5f;
+  state.posX[cue] = -distance;
+  state.posY[cue] = state.groundY + radius;
+  state.posZ[cue] = 0.05f * radius * randomSigned(seed, cue, 0);
+  state.velX[cue] = 10.0f;
+  state.velY[cue] = 0.0f;
+  state.velZ[cue] = 0.0f;
+  state.radius[cue] = radius;
+}
+
+bool generateScene(SimulationState &state, const char *name, size_t count,
+                   uint64_t seed) {
+  if (strcmp(name, "lattice") == 0) {
+    generateLattice(state, count, seed);
+  } else if (strcmp(name, "gas") == 0) {
+    generateGas(state, count, seed);
+  } else if (strcmp(name, "pile") == 0) {
+    generatePile(state, count, seed);
+  } else if (strcmp(name, "cradle") == 0) {
+    generateCradles(state, count, seed);
+  } else if (strcmp(name, "billiards") == 0) {
+    generateBilliards(state, count, seed);
+  } else {
+    return false;
+  }
+  return true;
+}
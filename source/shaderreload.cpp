@@ -0,0 +1,117 @@
+#include "shaderreload.h"
+#include <cstring>
+#include <iostream>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+ShaderReloader::ShaderReloader() : notifyFd(-1) {}
+
+ShaderReloader::~ShaderReloader() {
+  for (Entry &entry : entries) {
+    if (entry.building) {
+      glDeleteProgram(entry.build.program);
+      glDeleteShader(entry.build.vertexShader);
+      glDeleteShader(entry.build.fragmentShader);
+    }
+  }
+  if (notifyFd >= 0) {
+    close(notifyFd);
+  }
+}
+
+bool ShaderReloader::start(const char *directory) {
+  notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  // Editors either rewrite the file or rename a new one over it
+  if (notifyFd < 0 ||
+      inotify_add_watch(notifyFd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) <
+          0) {
+    std::cerr << "Error: Cannot watch " << directory << std::endl;
+    return false;
+  }
+  if (GLEW_KHR_parallel_shader_compile) {
+    // As many compiler threads as the driver likes
+    glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+  }
+  return true;
+}
+
+void ShaderReloader::watch(const char *vertexPath, const char *fragmentPath,
+                           unsigned features,
+                           std::function<void(GLuint)> swap) {
+  Entry entry;
+  entry.vertexPath = vertexPath;
+  entry.fragmentPath = fragmentPath;
+  entry.features = features;
+  entry.vertexName = ShaderVariantName(vertexPath, features);
+  entry.fragmentName = ShaderVariantName(fragmentPath, features);
+  entry.swap = std::move(swap);
+  entry.changed = false;
+  entry.building = false;
+  entries.push_back(std::move(entry));
+}
+
+// File name part of a path, what inotify reports
+static const char *baseName(const std::string &path) {
+  size_t slash = path.find_last_of('/');
+  return path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+void ShaderReloader::readEvents() {
+  alignas(inotify_event) char buffer[4096];
+  for (;;) {
+    ssize_t length = read(notifyFd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      return;
+    }
+    for (ssize_t offset = 0; offset < length;) {
+      const inotify_event *event =
+          reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+      if (event->len == 0) {
+        continue;
+      }
+      for (Entry &entry : entries) {
+        if (strcmp(event->name, baseName(entry.vertexPath)) == 0 ||
+            strcmp(event->name, baseName(entry.fragmentPath)) == 0) {
+          entry.changed = true;
+        }
+      }
+    }
+  }
+}
+
+void ShaderReloader::poll() {
+  if (notifyFd < 0) {
+    return;
+  }
+  readEvents();
+
+  for (Entry &entry : entries) {
+    const std::string &vertexName = entry.vertexName;
+    const std::string &fragmentName = entry.fragmentName;
+    if (entry.building && ProgramBuildDone(entry.build)) {
+      entry.building = false;
+      GLuint program = EndProgram(entry.build, vertexName.c_str(),
+                                  fragmentName.c_str());
+      if (program != 0) {
+        std::cout << "Reloaded " << vertexName << " and " << fragmentName
+                  << std::endl;
+        entry.swap(program);
+      }
+    }
+
+    // A change during a build waits for it, then builds again
+    if (entry.changed && !entry.building) {
+      entry.changed = false;
+      std::string vertexCode, fragmentCode;
+      if (ReadShaderFile(entry.vertexPath.c_str(), vertexCode) &&
+          ReadShaderFile(entry.fragmentPath.c_str(), fragmentCode)) {
+        vertexCode = SpecializeShader(vertexCode, entry.features);
+        fragmentCode = SpecializeShader(fragmentCode, entry.features);
+        entry.build = BeginProgram(vertexCode.c_str(), fragmentCode.c_str(),
+                                   vertexName.c_str(), fragmentName.c_str());
+        entry.building = true;
+      }
+    }
+  }
+}
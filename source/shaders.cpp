@@ -1,93 +1,177 @@
 #include "shaders.h"
+#include "programcache.h"
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <vector>
 
-GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path) {
-    // Create the shaders
-    GLuint VertexShaderID = glCreateShader(GL_VERTEX_SHADER);
-    GLuint FragmentShaderID = glCreateShader(GL_FRAGMENT_SHADER);
+bool ReadShaderFile(const char* path, std::string& code) {
+    std::ifstream stream(path, std::ios::in);
+    if (!stream.is_open()) {
+        std::cerr << "Error: Cannot open " << path << std::endl;
+        return false;
+    }
+    std::stringstream sstr;
+    sstr << stream.rdbuf();
+    code = sstr.str();
+    return true;
+}
 
-    // Read the Vertex Shader code from the file
-    std::string VertexShaderCode;
-    std::ifstream VertexShaderStream(vertex_file_path, std::ios::in);
-    if (VertexShaderStream.is_open()) {
-        std::stringstream sstr;
-        sstr << VertexShaderStream.rdbuf();
-        VertexShaderCode = sstr.str();
-        VertexShaderStream.close();
-    } else {
-        std::cerr << "Error: Cannot open " << vertex_file_path << std::endl;
-        return 0;
+static const char* const ShaderFeatureNames[] = {"GROUND", "INSTANCED",
+                                                 "TEXTURE_ARRAY"};
+static const unsigned ShaderFeatureCount =
+    sizeof(ShaderFeatureNames) / sizeof(ShaderFeatureNames[0]);
+
+std::string SpecializeShader(const std::string& source, unsigned features) {
+    if (features == 0) {
+        return source;
     }
+    // #version has to stay first, the defines go right after it
+    size_t version = source.find("#version");
+    size_t insert = version == std::string::npos ? 0 : source.find('\n', version);
+    insert = insert == std::string::npos ? source.size() : insert + 1;
+    int nextLine = 1 + (int)std::count(source.begin(), source.begin() + insert, '\n');
 
-    // Read the Fragment Shader code from the file
+    std::string defines;
+    for (unsigned i = 0; i < ShaderFeatureCount; ++i) {
+        if (features & (1u << i)) {
+            defines += "#define ";
+            defines += ShaderFeatureNames[i];
+            defines += " 1\n";
+        }
+    }
+    defines += "#line " + std::to_string(nextLine) + "\n";
+    return source.substr(0, insert) + defines + source.substr(insert);
+}
+
+std::string ShaderVariantName(const char* path, unsigned features) {
+    std::string name(path);
+    const char* separator = " [";
+    for (unsigned i = 0; i < ShaderFeatureCount; ++i) {
+        if (features & (1u << i)) {
+            name += separator;
+            name += ShaderFeatureNames[i];
+            separator = " ";
+        }
+    }
+    if (features != 0) {
+        name += "]";
+    }
+    return name;
+}
+
+GLuint LoadShaders(const char* vertex_file_path, const char* fragment_file_path,
+                   unsigned features) {
+    // Read the shader code from the files
+    std::string VertexShaderCode;
     std::string FragmentShaderCode;
-    std::ifstream FragmentShaderStream(fragment_file_path, std::ios::in);
-    if (FragmentShaderStream.is_open()) {
-        std::stringstream sstr;
-        sstr << FragmentShaderStream.rdbuf();
-        FragmentShaderCode = sstr.str();
-        FragmentShaderStream.close();
-    } else {
-        std::cerr << "Error: Cannot open " << fragment_file_path << std::endl;
+    if (!ReadShaderFile(vertex_file_path, VertexShaderCode) ||
+        !ReadShaderFile(fragment_file_path, FragmentShaderCode)) {
         return 0;
     }
+    VertexShaderCode = SpecializeShader(VertexShaderCode, features);
+    FragmentShaderCode = SpecializeShader(FragmentShaderCode, features);
+    std::string VertexName = ShaderVariantName(vertex_file_path, features);
+    std::string FragmentName = ShaderVariantName(fragment_file_path, features);
+    return LoadProgram(VertexShaderCode.c_str(), FragmentShaderCode.c_str(),
+                       VertexName.c_str(), FragmentName.c_str());
+}
 
-    GLint Result = GL_FALSE;
-    int InfoLogLength;
+GLuint BuildProgram(const char* vertex_code, const char* fragment_code,
+                    const char* vertex_name, const char* fragment_name) {
+    ProgramBuild build = BeginProgram(vertex_code, fragment_code,
+                                      vertex_name, fragment_name);
+    return EndProgram(build, vertex_name, fragment_name);
+}
+
+ProgramBuild BeginProgram(const char* vertex_code, const char* fragment_code,
+                          const char* vertex_name, const char* fragment_name) {
+    ProgramBuild build;
 
     // Compile Vertex Shader
-    std::cout << "Compiling shader: " << vertex_file_path << std::endl;
-    const char* VertexSourcePointer = VertexShaderCode.c_str();
-    glShaderSource(VertexShaderID, 1, &VertexSourcePointer, NULL);
-    glCompileShader(VertexShaderID);
-
-    // Check Vertex Shader
-    glGetShaderiv(VertexShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(VertexShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
-    if (InfoLogLength > 0) {
-        std::vector<char> VertexShaderErrorMessage(InfoLogLength + 1);
-        glGetShaderInfoLog(VertexShaderID, InfoLogLength, NULL, VertexShaderErrorMessage.data());
-        std::cerr << VertexShaderErrorMessage.data() << std::endl;
-    }
+    std::cout << "Compiling shader: " << vertex_name << std::endl;
+    build.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertexShader, 1, &vertex_code, NULL);
+    glCompileShader(build.vertexShader);
 
     // Compile Fragment Shader
-    std::cout << "Compiling shader: " << fragment_file_path << std::endl;
-    const char* FragmentSourcePointer = FragmentShaderCode.c_str();
-    glShaderSource(FragmentShaderID, 1, &FragmentSourcePointer, NULL);
-    glCompileShader(FragmentShaderID);
-
-    // Check Fragment Shader
-    glGetShaderiv(FragmentShaderID, GL_COMPILE_STATUS, &Result);
-    glGetShaderiv(FragmentShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    std::cout << "Compiling shader: " << fragment_name << std::endl;
+    build.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragmentShader, 1, &fragment_code, NULL);
+    glCompileShader(build.fragmentShader);
+
+    // Link the program. With parallel compilation none of these calls
+    // wait, the driver finishes in the background.
+    std::cout << "Linking program" << std::endl;
+    build.program = glCreateProgram();
+    // Lets the program cache read the linked binary back
+    if (GLEW_ARB_get_program_binary) {
+        glProgramParameteri(build.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(build.program, build.vertexShader);
+    glAttachShader(build.program, build.fragmentShader);
+    glLinkProgram(build.program);
+    return build;
+}
+
+bool ProgramBuildDone(const ProgramBuild& build) {
+    if (!GLEW_KHR_parallel_shader_compile) {
+        return true;
+    }
+    GLint Done = GL_FALSE;
+    glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &Done);
+    return Done == GL_TRUE;
+}
+
+// Print the info log of a shader, true if it compiled
+static bool CheckShader(GLuint ShaderID, const char* name) {
+    GLint Result = GL_FALSE;
+    int InfoLogLength;
+    glGetShaderiv(ShaderID, GL_COMPILE_STATUS, &Result);
+    glGetShaderiv(ShaderID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    if (Result != GL_TRUE) {
+        std::cerr << "Error: " << name << " failed to compile" << std::endl;
+    }
     if (InfoLogLength > 0) {
-        std::vector<char> FragmentShaderErrorMessage(InfoLogLength + 1);
-        glGetShaderInfoLog(FragmentShaderID, InfoLogLength, NULL, FragmentShaderErrorMessage.data());
-        std::cerr << FragmentShaderErrorMessage.data() << std::endl;
+        std::vector<char> ShaderErrorMessage(InfoLogLength + 1);
+        glGetShaderInfoLog(ShaderID, InfoLogLength, NULL, ShaderErrorMessage.data());
+        std::cerr << ShaderErrorMessage.data() << std::endl;
     }
+    return Result == GL_TRUE;
+}
 
-    // Link the program
-    std::cout << "Linking program" << std::endl;
-    GLuint ProgramID = glCreateProgram();
-    glAttachShader(ProgramID, VertexShaderID);
-    glAttachShader(ProgramID, FragmentShaderID);
-    glLinkProgram(ProgramID);
+GLuint EndProgram(ProgramBuild& build, const char* vertex_name,
+                  const char* fragment_name) {
+    // Check the shaders
+    bool Compiled = CheckShader(build.vertexShader, vertex_name);
+    Compiled = CheckShader(build.fragmentShader, fragment_name) && Compiled;
 
     // Check the program
-    glGetProgramiv(ProgramID, GL_LINK_STATUS, &Result);
-    glGetProgramiv(ProgramID, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    GLint Result = GL_FALSE;
+    int InfoLogLength;
+    glGetProgramiv(build.program, GL_LINK_STATUS, &Result);
+    glGetProgramiv(build.program, GL_INFO_LOG_LENGTH, &InfoLogLength);
+    if (Compiled && Result != GL_TRUE) {
+        std::cerr << "Error: " << vertex_name << " and " << fragment_name
+                  << " failed to link" << std::endl;
+    }
     if (InfoLogLength > 0) {
         std::vector<char> ProgramErrorMessage(InfoLogLength + 1);
-        glGetProgramInfoLog(ProgramID, InfoLogLength, NULL, ProgramErrorMessage.data());
+        glGetProgramInfoLog(build.program, InfoLogLength, NULL, ProgramErrorMessage.data());
         std::cerr << ProgramErrorMessage.data() << std::endl;
     }
 
-    glDetachShader(ProgramID, VertexShaderID);
-    glDetachShader(ProgramID, FragmentShaderID);
-    glDeleteShader(VertexShaderID);
-    glDeleteShader(FragmentShaderID);
+    glDetachShader(build.program, build.vertexShader);
+    glDetachShader(build.program, build.fragmentShader);
+    glDeleteShader(build.vertexShader);
+    glDeleteShader(build.fragmentShader);
 
+    GLuint ProgramID = build.program;
+    build = ProgramBuild();
+    if (Result != GL_TRUE) {
+        glDeleteProgram(ProgramID);
+        return 0;
+    }
     return ProgramID;
 }
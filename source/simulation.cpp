@@ -0,0 +1,272 @@
+#include "simulation.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+
+size_t SimulationState::addBody(float x, float y, float z, float vx, float vy,
+                                float vz, float r) {
+  posX.push_back(x);
+  posY.push_back(y);
+  posZ.push_back(z);
+  velX.push_back(vx);
+  velY.push_back(vy);
+  velZ.push_back(vz);
+  radius.push_back(r);
+  rotation.push_back(0.0f);
+  sleepTimer.push_back(0.0f);
+  awake.push_back(1);
+  island.push_back(uint32_t(radius.size() - 1));
+  return radius.size() - 1;
+}
+
+bool validBody(const SimulationState &state, size_t i) {
+  return std::isfinite(state.posX[i]) && std::isfinite(state.posY[i]) &&
+         std::isfinite(state.posZ[i]) && std::isfinite(state.velX[i]) &&
+         std::isfinite(state.velY[i]) && std::isfinite(state.velZ[i]) &&
+         validRadius(state.radius[i]);
+}
+
+void SimulationState::resize(size_t count) {
+  posX.resize(count);
+  posY.resize(count);
+  posZ.resize(count);
+  velX.resize(count);
+  velY.resize(count);
+  velZ.resize(count);
+  radius.resize(count);
+  rotation.resize(count);
+  sleepTimer.resize(count);
+  awake.resize(count, 1);
+  size_t old = island.size();
+  island.resize(count);
+  for (size_t i = old; i < count; ++i) {
+    island[i] = uint32_t(i);
+  }
+}
+
+void SimulationState::clear() {
+  posX.clear();
+  posY.clear();
+  posZ.clear();
+  velX.clear();
+  velY.clear();
+  velZ.clear();
+  radius.clear();
+  rotation.clear();
+  sleepTimer.clear();
+  awake.clear();
+  island.clear();
+  contactCache.clear();
+  sleptKinetic = 0.0;
+  std::fill(sleptMomentum, sleptMomentum + 3, 0.0);
+  dissipatedEnergy = 0.0;
+  stepCount = 0;
+}
+
+void integrateBodies(SimulationState &state, float deltaTime) {
+  PROFILE_FUNCTION();
+  size_t count = state.size();
+
+  // Implicit drag, never reverses a velocity however large the step
+  float drag = 1.0f / (1.0f + state.damping * deltaTime);
+
+  // Update sphere velocities and positions
+  for (size_t i = 0; i < count; ++i) {
+    if (!state.awake[i]) {
+      continue;
+    }
+    state.velY[i] -= state.gravity * deltaTime;
+    if (state.damping > 0.0f) {
+      // Taken from the energy the integrator keeps, see energy.h
+      double speedSquared = state.velX[i] * state.velX[i] +
+                            state.velY[i] * state.velY[i] +
+                            state.velZ[i] * state.velZ[i];
+      double lost = 0.5 * speedSquared * (1.0 - double(drag) * drag) +
+                    0.5 * state.gravity * deltaTime * state.velY[i] *
+                        (1.0 - drag);
+      state.dissipatedEnergy += bodyMass(state.radius[i]) * lost;
+      state.velX[i] *= drag;
+      state.velY[i] *= drag;
+      state.velZ[i] *= drag;
+    }
+    state.posX[i] += state.velX[i] * deltaTime;
+    state.posY[i] += state.velY[i] * deltaTime;
+    state.posZ[i] += state.velZ[i] * deltaTime;
+  }
+}
+
+void collideWithGround(SimulationState &state, float deltaTime) {
+  PROFILE_FUNCTION();
+  size_t count = state.size();
+  float lift = 0.5f * state.gravity * deltaTime;
+
+  // Bounce off the ground plane, sleepers already rest on it or on others
+  for (size_t i = 0; i < count; ++i) {
+    if (!state.awake[i]) {
+      continue;
+    }
+    float bottom = state.groundY + state.radius[i];
+    if (state.posY[i] < bottom) {
+      // Leave at the speed that keeps the energy the integrator conserves
+      // (see energy.h). Mirroring the velocity from below the ground lost
+      // up to gravity * speed * dt per bounce, a dropped ball came back
+      // lower every time.
+      float speed = state.velY[i];
+      if (speed < 0.0f) {
+        float energy = 0.5f * speed * speed - lift * speed +
+                       state.gravity * (state.posY[i] - bottom);
+        state.velY[i] =
+            lift + std::sqrt(std::max(lift * lift + 2.0f * energy, 0.0f));
+      }
+      state.posY[i] = bottom;
+    }
+  }
+}
+
+void rollBodies(SimulationState &state, float deltaTime) {
+  PROFILE_FUNCTION();
+  size_t count = state.size();
+
+  // Roll the spheres according to their speed along x
+  for (size_t i = 0; i < count; ++i) {
+    if (state.velX[i] != 0.0f) {
+      state.rotation[i] += (state.velX[i] / state.radius[i]) * deltaTime * 2.0f;
+    }
+  }
+}
+
+void wakeBody(SimulationState &state, size_t i) {
+  state.awake[i] = 1;
+  state.sleepTimer[i] = 0.0f;
+  state.island[i] = uint32_t(i);
+}
+
+bool wakeTouchedIslands(SimulationState &state,
+                        const std::vector<BodyPair> &pairs,
+                        StepArenas &arenas) {
+  PROFILE_FUNCTION();
+  uint32_t count = state.size();
+  uint8_t *woken = nullptr;
+  for (const BodyPair &pair : pairs) {
+    uint32_t i = pair.a, j = pair.b;
+    if (state.awake[i] == state.awake[j]) {
+      continue;
+    }
+    float dx = state.posX[j] - state.posX[i];
+    float dy = state.posY[j] - state.posY[i];
+    float dz = state.posZ[j] - state.posZ[i];
+    float reach = state.radius[i] + state.radius[j];
+    if (dx * dx + dy * dy + dz * dz > reach * reach) {
+      continue;
+    }
+    if (!woken) {
+      woken = arenas.shared().allocate<uint8_t>(count);
+      std::fill(woken, woken + count, 0);
+    }
+    woken[state.island[state.awake[i] ? j : i]] = 1;
+  }
+  if (!woken) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!state.awake[i] && woken[state.island[i]]) {
+      wakeBody(state, i);
+    }
+  }
+  return true;
+}
+
+// Root of body i's island, halving the path on the way
+static uint32_t findIsland(uint32_t *parent, uint32_t i) {
+  while (parent[i] != i) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+void updateSleep(SimulationState &state, const std::vector<BodyPair> &pairs,
+                 StepArenas &arenas, float deltaTime) {
+  PROFILE_FUNCTION();
+  uint32_t count = state.size();
+  LinearArena &arena = arenas.shared();
+
+  // Islands of awake bodies only. Any sleeper an awake body overlapped was
+  // woken with its island before the solve, the pairs left with a sleeper
+  // are boxes that merely overlap and the sleepers keep their own island.
+  uint32_t *parent = arena.allocate<uint32_t>(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    parent[i] = i;
+  }
+  for (const BodyPair &pair : pairs) {
+    if (!state.awake[pair.a] || !state.awake[pair.b]) {
+      continue;
+    }
+    uint32_t a = findIsland(parent, pair.a);
+    uint32_t b = findIsland(parent, pair.b);
+    if (a != b) {
+      // The lower index is the root, independent of the pair order
+      parent[std::max(a, b)] = std::min(a, b);
+    }
+  }
+
+  // An island is as rested as its least rested body
+  float *islandRest = arena.allocate<float>(count);
+  std::fill(islandRest, islandRest + count, timeToSleep);
+  float limit = sleepSpeed * sleepSpeed;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!state.awake[i]) {
+      continue;
+    }
+    float speed = state.velX[i] * state.velX[i] +
+                  state.velY[i] * state.velY[i] +
+                  state.velZ[i] * state.velZ[i];
+    state.sleepTimer[i] =
+        speed > limit ? 0.0f : state.sleepTimer[i] + deltaTime;
+    uint32_t root = findIsland(parent, i);
+    islandRest[root] = std::min(islandRest[root], state.sleepTimer[i]);
+  }
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t root = findIsland(parent, i);
+    if (state.awake[i] && islandRest[root] >= timeToSleep) {
+      double mass = bodyMass(state.radius[i]);
+      double vx = state.velX[i], vy = state.velY[i], vz = state.velZ[i];
+      state.sleptKinetic += 0.5 * mass * (vx * vx + vy * vy + vz * vz);
+      state.sleptMomentum[0] += mass * vx;
+      state.sleptMomentum[1] += mass * vy;
+      state.sleptMomentum[2] += mass * vz;
+      state.awake[i] = 0;
+      state.island[i] = root;
+      state.velX[i] = 0.0f;
+      state.velY[i] = 0.0f;
+      state.velZ[i] = 0.0f;
+    }
+  }
+}
+
+void stepSimulation(SimulationState &state, SimulationWorkspace &workspace,
+                    float deltaTime) {
+  PROFILE_SCOPE("stepSimulation");
+  workspace.arenas.reset();
+  integrateBodies(state, deltaTime);
+  collideWithGround(state, deltaTime);
+
+  // Pairs come back in (a, b) order, the order the old all-pairs loop used
+  findPairs(workspace.broadPhase, state, workspace.arenas, workspace.pairs);
+  // Pairs inside a sleeping island were left out, find them again once an
+  // awake body has woken it
+  if (wakeTouchedIslands(state, workspace.pairs, workspace.arenas)) {
+    findPairs(workspace.broadPhase, state, workspace.arenas, workspace.pairs);
+  }
+  state.contactCache.beginStep(workspace.pairs.size());
+  buildContacts(state, workspace.pairs, state.contactCache, workspace.solver);
+  colorContacts(state.size(), workspace.arenas, workspace.solver);
+  workspace.contactCount = solveContacts(state, workspace.solver);
+  storeContactImpulses(workspace.solver, state.contactCache);
+
+  rollBodies(state, deltaTime);
+  updateSleep(state, workspace.pairs, workspace.arenas, deltaTime);
+  ++state.stepCount;
+}
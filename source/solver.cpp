@@ -0,0 +1,209 @@
+#include "solver.h"
+#include "arena.h"
+#include "broadphase.h"
+#include "parallel.h"
+#include "profiler.h"
+#include "simulation.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// Colors tracked per body in one 64-bit mask
+static const int maxColors = 64;
+
+// Contacts handed to one thread, smaller batches stay on the caller
+static const size_t solveGrain = 256;
+
+void buildContacts(const SimulationState &state,
+                   const std::vector<BodyPair> &pairs,
+                   const ContactCache &warmStart, ContactSolver &solver) {
+  PROFILE_FUNCTION();
+  solver.contacts.clear();
+  for (const BodyPair &pair : pairs) {
+    uint32_t i = pair.a, j = pair.b;
+    float dx = state.posX[j] - state.posX[i];
+    float dy = state.posY[j] - state.posY[i];
+    float dz = state.posZ[j] - state.posZ[i];
+    float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+    if (distance > state.radius[i] + state.radius[j] || distance == 0.0f) {
+      continue;
+    }
+
+    Contact contact;
+    contact.a = i;
+    contact.b = j;
+    contact.normal[0] = dx / distance;
+    contact.normal[1] = dy / distance;
+    contact.normal[2] = dz / distance;
+    float inverseMassA = 1.0f / bodyMass(state.radius[i]);
+    float inverseMassB = 1.0f / bodyMass(state.radius[j]);
+    contact.normalMass = 1.0f / (inverseMassA + inverseMassB);
+    contact.bounceImpulse = 0.0f;
+    contact.restingImpulse = warmStart.find(i, j);
+    contact.absorbed = 0.0f;
+    solver.contacts.push_back(contact);
+  }
+}
+
+void colorContacts(size_t bodyCount, StepArenas &arenas,
+                   ContactSolver &solver) {
+  PROFILE_FUNCTION();
+  size_t count = solver.contacts.size();
+  LinearArena &arena = arenas.shared();
+  uint64_t *usedColors = arena.allocate<uint64_t>(bodyCount);
+  std::fill(usedColors, usedColors + bodyCount, 0);
+  uint8_t *colors = arena.allocate<uint8_t>(count);
+
+  // Lowest color neither body has yet, or the serial overflow batch
+  solver.batchStart.assign(maxColors + 2, 0);
+  for (size_t c = 0; c < count; ++c) {
+    const Contact &contact = solver.contacts[c];
+    uint64_t free = ~(usedColors[contact.a] | usedColors[contact.b]);
+    int color = maxColors;
+    if (free != 0) {
+      color = __builtin_ctzll(free);
+      usedColors[contact.a] |= uint64_t(1) << color;
+      usedColors[contact.b] |= uint64_t(1) << color;
+    }
+    colors[c] = (uint8_t)color;
+    ++solver.batchStart[color + 1];
+  }
+
+  // Counting sort by color, pair order kept within a color
+  for (int color = 0; color <= maxColors; ++color) {
+    solver.batchStart[color + 1] += solver.batchStart[color];
+  }
+  solver.batchContacts.resize(count);
+  uint32_t *filled = arena.allocate<uint32_t>(maxColors + 1);
+  std::copy(solver.batchStart.begin(), solver.batchStart.end() - 1, filled);
+  for (size_t c = 0; c < count; ++c) {
+    solver.batchContacts[filled[colors[c]]++] = (uint32_t)c;
+  }
+}
+
+// Push both bodies apart along the normal by impulse
+static inline void applyImpulse(SimulationState &state, const Contact &contact,
+                                float impulse) {
+  float impulseA = impulse / bodyMass(state.radius[contact.a]);
+  float impulseB = impulse / bodyMass(state.radius[contact.b]);
+  state.velX[contact.a] -= impulseA * contact.normal[0];
+  state.velY[contact.a] -= impulseA * contact.normal[1];
+  state.velZ[contact.a] -= impulseA * contact.normal[2];
+  state.velX[contact.b] += impulseB * contact.normal[0];
+  state.velY[contact.b] += impulseB * contact.normal[1];
+  state.velZ[contact.b] += impulseB * contact.normal[2];
+}
+
+// Speed at which a and b close in along the normal
+static inline float approachSpeed(const SimulationState &state,
+                                  const Contact &contact) {
+  uint32_t a = contact.a, b = contact.b;
+  return (state.velX[a] - state.velX[b]) * contact.normal[0] +
+         (state.velY[a] - state.velY[b]) * contact.normal[1] +
+         (state.velZ[a] - state.velZ[b]) * contact.normal[2];
+}
+
+// Kinetic energy an impulse along the normal takes out of a pair closing in
+// at approach
+static inline float absorbedEnergy(const Contact &contact, float approach,
+                                   float impulse) {
+  return impulse * (approach - 0.5f * impulse / contact.normalMass);
+}
+
+// The bounce an isolated pair would get, from the velocities as they are
+// now. Returns false if the contact was not approaching.
+static inline bool bounceContact(SimulationState &state, Contact &contact) {
+  float approach = approachSpeed(state, contact);
+  if (approach <= 0.0f) {
+    return false;
+  }
+  float impulse = (1.0f + contactRestitution) * contact.normalMass * approach;
+  contact.bounceImpulse += impulse;
+  applyImpulse(state, contact, impulse);
+  return true;
+}
+
+// One Gauss-Seidel update of the accumulated resting impulse towards no
+// approach
+static inline bool restContact(SimulationState &state, Contact &contact) {
+  float approach = approachSpeed(state, contact);
+  float impulse = contact.restingImpulse + contact.normalMass * approach;
+  // A contact can push but never pull
+  impulse = std::max(impulse, 0.0f);
+  float delta = impulse - contact.restingImpulse;
+  contact.restingImpulse = impulse;
+  contact.absorbed += absorbedEnergy(contact, approach, delta);
+  applyImpulse(state, contact, delta);
+  return delta != 0.0f;
+}
+
+// One sweep over every color in turn. Returns whether any contact changed.
+template <typename Update>
+static bool sweepBatches(SimulationState &state, ContactSolver &solver,
+                         Update update) {
+  Contact *contacts = solver.contacts.data();
+  const uint32_t *order = solver.batchContacts.data();
+  std::atomic<bool> changed{false};
+  for (int color = 0; color <= maxColors; ++color) {
+    uint32_t begin = solver.batchStart[color];
+    uint32_t end = solver.batchStart[color + 1];
+    // No two contacts of a color share a body, any order gives the same;
+    // the overflow batch does not have that guarantee and stays serial
+    size_t grain = color < maxColors ? solveGrain : end - begin + 1;
+    parallelFor(end - begin, grain, [&](size_t first, size_t last) {
+      bool any = false;
+      for (size_t k = begin + first; k < begin + last; ++k) {
+        any |= update(state, contacts[order[k]]);
+      }
+      if (any) {
+        changed.store(true, std::memory_order_relaxed);
+      }
+    });
+  }
+  return changed.load(std::memory_order_relaxed);
+}
+
+size_t solveContacts(SimulationState &state, ContactSolver &solver) {
+  PROFILE_SCOPE("solveContacts");
+  for (Contact &contact : solver.contacts) {
+    contact.absorbed = absorbedEnergy(contact, approachSpeed(state, contact),
+                                      contact.restingImpulse);
+    applyImpulse(state, contact, contact.restingImpulse);
+  }
+
+  // Impacts first. Each sweep carries them one contact further along a row,
+  // two with the colors alternating down it; once nothing approaches the
+  // rest are no-ops. A target fixed before the first impulse would instead
+  // bounce a row of touching bodies off as one lumped mass.
+  for (int sweep = 0; sweep < solver.iterations; ++sweep) {
+    if (!sweepBatches(state, solver, bounceContact)) {
+      break;
+    }
+  }
+
+  // Whatever still approaches, in a pile that is not done bouncing or a
+  // stack under gravity, comes to rest. Only this impulse warm starts the
+  // next step, a warm started bounce would push pairs already separating.
+  for (int iteration = 0; iteration < solver.iterations; ++iteration) {
+    sweepBatches(state, solver, restContact);
+  }
+
+  // Summed in contact order, the total is the same for any thread count
+  size_t pushing = 0;
+  double absorbed = 0.0;
+  for (const Contact &contact : solver.contacts) {
+    pushing += contact.bounceImpulse + contact.restingImpulse > 0.0f;
+    absorbed += contact.absorbed;
+  }
+  state.dissipatedEnergy += absorbed;
+  return pushing;
+}
+
+void storeContactImpulses(const ContactSolver &solver, ContactCache &cache) {
+  PROFILE_FUNCTION();
+  for (const Contact &contact : solver.contacts) {
+    if (contact.restingImpulse > 0.0f) {
+      cache.store(contact.a, contact.b, contact.restingImpulse);
+    }
+  }
+}
@@ -0,0 +1,201 @@
+#include "texcompress.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+void resizeImage(const unsigned char *source, int sourceWidth,
+                 int sourceHeight, ptrdiff_t sourceStride,
+                 unsigned char *target, int targetWidth, int targetHeight) {
+  // Sample at pixel centres, clamped to the edges
+  float scaleX = float(sourceWidth) / targetWidth;
+  float scaleY = float(sourceHeight) / targetHeight;
+  for (int y = 0; y < targetHeight; ++y) {
+    float sy = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+    int y0 = std::min(int(sy), sourceHeight - 1);
+    int y1 = std::min(y0 + 1, sourceHeight - 1);
+    float fy = sy - y0;
+    const unsigned char *row0 = source + y0 * sourceStride;
+    const unsigned char *row1 = source + y1 * sourceStride;
+    unsigned char *out = target + size_t(y) * targetWidth * 3;
+
+    for (int x = 0; x < targetWidth; ++x) {
+      float sx = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+      int x0 = std::min(int(sx), sourceWidth - 1);
+      int x1 = std::min(x0 + 1, sourceWidth - 1);
+      float fx = sx - x0;
+      for (int c = 0; c < 3; ++c) {
+        float top =
+            row0[x0 * 3 + c] + (row0[x1 * 3 + c] - row0[x0 * 3 + c]) * fx;
+        float bottom =
+            row1[x0 * 3 + c] + (row1[x1 * 3 + c] - row1[x0 * 3 + c]) * fx;
+        out[x * 3 + c] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+      }
+    }
+  }
+}
+
+int mipLevelCount(int width, int height) {
+  int levels = 1;
+  for (int size = std::max(width, height); size > 1; size /= 2) {
+    ++levels;
+  }
+  return levels;
+}
+
+void downsampleBox(const unsigned char *source, int width, int height,
+                   unsigned char *target) {
+  int targetWidth = std::max(1, width / 2);
+  int targetHeight = std::max(1, height / 2);
+  for (int y = 0; y < targetHeight; ++y) {
+    // Odd or unit sizes reuse the last row and column
+    const unsigned char *row0 = source + size_t(2 * y) * width * 3;
+    const unsigned char *row1 =
+        source + size_t(std::min(2 * y + 1, height - 1)) * width * 3;
+    unsigned char *out = target + size_t(y) * targetWidth * 3;
+    for (int x = 0; x < targetWidth; ++x) {
+      int x0 = 2 * x * 3;
+      int x1 = std::min(2 * x + 1, width - 1) * 3;
+      for (int c = 0; c < 3; ++c) {
+        int sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+        out[x * 3 + c] = (unsigned char)((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+size_t bc1Size(int width, int height) {
+  return size_t((width + 3) / 4) * ((height + 3) / 4) * 8;
+}
+
+// 5:6:5 colour packed the way BC1 stores its endpoints
+static uint16_t packColor(const int bgr[3]) {
+  int b = (bgr[0] * 31 + 127) / 255;
+  int g = (bgr[1] * 63 + 127) / 255;
+  int r = (bgr[2] * 31 + 127) / 255;
+  return uint16_t(r << 11 | g << 5 | b);
+}
+
+static void unpackColor(uint16_t color, int bgr[3]) {
+  int r = color >> 11, g = (color >> 5) & 63, b = color & 31;
+  bgr[0] = b << 3 | b >> 2;
+  bgr[1] = g << 2 | g >> 4;
+  bgr[2] = r << 3 | r >> 2;
+}
+
+static void compressBlock(const unsigned char texels[16][3],
+                          unsigned char *block) {
+  // Endpoints at the extremes of the block along its principal axis,
+  // inset by 1/16 so outliers do not stretch the palette
+  float mean[3] = {0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 16; ++i) {
+    for (int c = 0; c < 3; ++c) {
+      mean[c] += texels[i][c] / 16.0f;
+    }
+  }
+  float covariance[6] = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f};
+  for (int i = 0; i < 16; ++i) {
+    float d[3] = {texels[i][0] - mean[0], texels[i][1] - mean[1],
+                  texels[i][2] - mean[2]};
+    covariance[0] += d[0] * d[0];
+    covariance[1] += d[0] * d[1];
+    covariance[2] += d[0] * d[2];
+    covariance[3] += d[1] * d[1];
+    covariance[4] += d[1] * d[2];
+    covariance[5] += d[2] * d[2];
+  }
+  // A few power iterations are plenty for a 3x3 matrix
+  float axis[3] = {1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3] = {
+        covariance[0] * axis[0] + covariance[1] * axis[1] +
+            covariance[2] * axis[2],
+        covariance[1] * axis[0] + covariance[3] * axis[1] +
+            covariance[4] * axis[2],
+        covariance[2] * axis[0] + covariance[4] * axis[1] +
+            covariance[5] * axis[2]};
+    float length = std::max(
+        {std::fabs(next[0]), std::fabs(next[1]), std::fabs(next[2])});
+    if (length < 1e-6f) {
+      break;
+    }
+    for (int c = 0; c < 3; ++c) {
+      axis[c] = next[c] / length;
+    }
+  }
+  float lowest = 0.0f, highest = 0.0f;
+  for (int i = 0; i < 16; ++i) {
+    float t = 0.0f;
+    for (int c = 0; c < 3; ++c) {
+      t += (texels[i][c] - mean[c]) * axis[c];
+    }
+    lowest = std::min(lowest, t);
+    highest = std::max(highest, t);
+  }
+  float inset = (highest - lowest) / 16.0f;
+  float norm = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+  int low[3], high[3];
+  for (int c = 0; c < 3; ++c) {
+    float direction = axis[c] / norm;
+    low[c] = std::clamp(int(mean[c] + (lowest + inset) * direction + 0.5f),
+                        0, 255);
+    high[c] = std::clamp(int(mean[c] + (highest - inset) * direction + 0.5f),
+                         0, 255);
+  }
+  uint16_t color0 = packColor(high);
+  uint16_t color1 = packColor(low);
+  uint32_t indices = 0;
+
+  if (color0 != color1) {
+    // color0 > color1 selects the four colour mode
+    if (color0 < color1) {
+      std::swap(color0, color1);
+    }
+    int palette[4][3];
+    unpackColor(color0, palette[0]);
+    unpackColor(color1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+      palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+      palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+    for (int i = 0; i < 16; ++i) {
+      int best = 0, bestDistance = 1 << 30;
+      for (int p = 0; p < 4; ++p) {
+        int distance = 0;
+        for (int c = 0; c < 3; ++c) {
+          int d = int(texels[i][c]) - palette[p][c];
+          distance += d * d;
+        }
+        if (distance < bestDistance) {
+          bestDistance = distance;
+          best = p;
+        }
+      }
+      indices |= uint32_t(best) << (2 * i);
+    }
+  }
+
+  block[0] = color0 & 0xff;
+  block[1] = color0 >> 8;
+  block[2] = color1 & 0xff;
+  block[3] = color1 >> 8;
+  for (int i = 0; i < 4; ++i) {
+    block[4 + i] = (indices >> (8 * i)) & 0xff;
+  }
+}
+
+void compressBC1(const unsigned char *pixels, int width, int height,
+                 unsigned char *blocks) {
+  unsigned char texels[16][3];
+  for (int by = 0; by < height; by += 4) {
+    for (int bx = 0; bx < width; bx += 4) {
+      for (int i = 0; i < 16; ++i) {
+        int x = std::min(bx + i % 4, width - 1);
+        int y = std::min(by + i / 4, height - 1);
+        memcpy(texels[i], pixels + (size_t(y) * width + x) * 3, 3);
+      }
+      compressBlock(texels, blocks);
+      blocks += 8;
+    }
+  }
+}
@@ -0,0 +1,23 @@
+#include "texturearray.h"
+
+bool TextureArray::load(const char *const *paths, int count, int layerWidth,
+                        int layerHeight) {
+  TextureData data;
+  bool loadedAll =
+      decodeTextureArray(paths, count, layerWidth, layerHeight, data);
+  upload(data);
+  return loadedAll;
+}
+
+void TextureArray::upload(const TextureData &data, GLuint pixelBuffer) {
+  if (!handle) {
+    handle = GLTexture::create();
+  }
+  layers = data.layers;
+  uploadTexture(handle.get(), data, pixelBuffer);
+}
+
+void TextureArray::bind(int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, handle.get());
+}
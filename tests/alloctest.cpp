@@ -0,0 +1,50 @@
+// Steady-state allocation check, run by `make check`
+//
+// Every scene is stepped once to warm up the buffers, then reset to its
+// start and stepped again. The second run has the same working set, so any
+// heap allocation in it is a step that does not reuse its memory.
+#include "alloccount.h"
+#include "scenegen.h"
+#include "simulation.h"
+#include <iostream>
+
+static const float stepTime = 1.0f / 60.0f;
+static const size_t bodyCount = 2000;
+static const int stepCount = 240;
+
+int main() {
+  if (!allocationCountingEnabled()) {
+    std::cerr << "FAILED: built without COUNT_ALLOCATIONS" << std::endl;
+    return 1;
+  }
+
+  const char *scenes[] = {"lattice", "gas", "pile", "cradle", "billiards"};
+  bool ok = true;
+  for (const char *scene : scenes) {
+    SimulationState initial;
+    generateScene(initial, scene, bodyCount, 1);
+    SimulationState state = initial;
+    SimulationWorkspace workspace;
+    for (int step = 0; step < stepCount; ++step) {
+      stepSimulation(state, workspace, stepTime);
+    }
+
+    state = initial;
+    uint64_t before = allocationCount();
+    for (int step = 0; step < stepCount; ++step) {
+      stepSimulation(state, workspace, stepTime);
+    }
+    uint64_t allocations = allocationCount() - before;
+    if (allocations != 0) {
+      std::cerr << "FAILED: " << scene << " allocated " << allocations
+                << " times after warm-up" << std::endl;
+      ok = false;
+    }
+  }
+
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "alloctest passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,63 @@
+// Newton's cradle check, run by `make check`
+//
+// A sphere hits the end of a row of four touching equal spheres. Restitution
+// has to travel down the row one contact at a time: the striker and the row
+// stop and only the far end leaves, with all of the speed and the energy.
+#include "simulation.h"
+#include <cmath>
+#include <iostream>
+
+static const float stepTime = 1.0f / 60.0f;
+static const size_t ballCount = 5;
+static const float strikeSpeed = 2.0f;
+static const float tolerance = 1e-4f;
+
+static bool check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+  }
+  return condition;
+}
+
+// All balls have the same mass, leave it out
+static double kineticEnergy(const SimulationState &state) {
+  double energy = 0.0;
+  for (size_t i = 0; i < state.size(); ++i) {
+    energy += 0.5 * (double(state.velX[i]) * state.velX[i] +
+                     double(state.velY[i]) * state.velY[i] +
+                     double(state.velZ[i]) * state.velZ[i]);
+  }
+  return energy;
+}
+
+int main() {
+  SimulationState state;
+  state.gravity = 0.0f;
+  float y = state.groundY + 0.5f;
+  state.addBody(0.0f, y, 0.0f, strikeSpeed, 0.0f, 0.0f, 0.5f);
+  for (size_t i = 1; i < ballCount; ++i) {
+    state.addBody(1.0f + float(i), y, 0.0f, 0.0f, 0.0f, 0.0f, 0.5f);
+  }
+  double before = kineticEnergy(state);
+  SimulationWorkspace workspace;
+
+  for (int step = 0; step < 120; ++step) {
+    stepSimulation(state, workspace, stepTime);
+  }
+
+  bool ok = true;
+  for (size_t i = 0; i + 1 < ballCount; ++i) {
+    ok &= check(std::fabs(state.velX[i]) < tolerance,
+                "a ball before the far end is still moving");
+  }
+  ok &= check(std::fabs(state.velX[ballCount - 1] - strikeSpeed) < tolerance,
+              "the far end did not leave with the striker's speed");
+  ok &= check(std::fabs(kineticEnergy(state) - before) < tolerance * before,
+              "the cradle did not conserve energy");
+
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "cradletest passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,42 @@
+// Energy monitor check, run by `make check`
+//
+// The gas and the lattice only have elastic contacts, the pile adds
+// gravity, ground bounces, damping and sleep. None of them may raise the
+// drift flag at a small, the usual or a large step.
+#include "energy.h"
+#include "scenegen.h"
+#include "simulation.h"
+#include <iostream>
+
+static const size_t bodyCount = 1000;
+static const int stepCount = 600;
+
+int main() {
+  const char *scenes[] = {"gas", "lattice", "pile"};
+  const float stepTimes[] = {1.0f / 250.0f, 1.0f / 60.0f, 1.0f / 30.0f};
+  bool ok = true;
+  for (const char *scene : scenes) {
+    for (float stepTime : stepTimes) {
+      SimulationState state;
+      generateScene(state, scene, bodyCount, 1);
+      SimulationWorkspace workspace;
+      EnergyMonitor monitor;
+      monitor.reset(state);
+      for (int step = 0; step < stepCount; ++step) {
+        stepSimulation(state, workspace, stepTime);
+        monitor.update(state, stepTime);
+      }
+      if (monitor.drifting()) {
+        std::cerr << "FAILED: " << scene << " at dt " << stepTime
+                  << " drifted by " << monitor.energyDrift() << std::endl;
+        ok = false;
+      }
+    }
+  }
+
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "energytest passed" << std::endl;
+  return 0;
+}
@@ -0,0 +1,91 @@
+// Sleeping island checks, run by `make check`
+//
+// A row of touching spheres is left to fall asleep on the ground, then a
+// fast sphere is fired into its end. The whole row has to wake in the step
+// of the hit, before the solver passes the impulse along it.
+#include "checkpoint.h"
+#include "simulation.h"
+#include <cstring>
+#include <iostream>
+
+static const float stepTime = 1.0f / 60.0f;
+static const size_t rowLength = 5;
+
+static bool check(bool condition, const char *what) {
+  if (!condition) {
+    std::cerr << "FAILED: " << what << std::endl;
+  }
+  return condition;
+}
+
+static size_t awakeCount(const SimulationState &state) {
+  size_t count = 0;
+  for (uint8_t awake : state.awake) {
+    count += awake;
+  }
+  return count;
+}
+
+int main() {
+  SimulationState state;
+  state.gravity = 9.81f;
+  for (size_t i = 0; i < rowLength; ++i) {
+    state.addBody(float(i), state.groundY + 0.5f, 0.0f, 0.0f, 0.0f, 0.0f,
+                  0.5f);
+  }
+  size_t ball = state.addBody(-20.0f, state.groundY + 0.5f, 0.0f, 0.0f,
+                              0.0f, 0.0f, 0.5f);
+  SimulationWorkspace workspace;
+
+  // The row and the still ball settle
+  for (int step = 0; step < 120; ++step) {
+    stepSimulation(state, workspace, stepTime);
+  }
+  bool ok = check(awakeCount(state) == 0, "resting row falls asleep");
+  for (size_t i = 1; i < rowLength; ++i) {
+    ok &= check(state.island[i] == state.island[0],
+                "row sleeps as one island");
+  }
+
+  // Wake the ball only, right next to the row and heading into it
+  state.posX[ball] = -1.05f;
+  state.velX[ball] = 10.0f;
+  wakeBody(state, ball);
+  SimulationState continued = state;
+  std::vector<unsigned char> checkpoint;
+  saveCheckpoint(state, checkpoint);
+
+  bool hit = false;
+  for (int step = 0; step < 10 && !hit; ++step) {
+    stepSimulation(state, workspace, stepTime);
+    hit = state.awake[0];
+    if (hit) {
+      ok &= check(awakeCount(state) == rowLength + 1,
+                  "whole row wakes in the step of the hit");
+      ok &= check(state.velX[rowLength - 1] > 0.0f,
+                  "far end of the row moves in the step of the hit");
+    }
+  }
+  ok &= check(hit, "ball reaches the row");
+
+  // Island ids are part of the state, a restore steps identically
+  SimulationState restored;
+  ok &= check(restoreCheckpoint(restored, checkpoint.data(),
+                                checkpoint.size()),
+              "checkpoint restores");
+  SimulationWorkspace continuedWorkspace, restoredWorkspace;
+  for (int step = 0; step < 10; ++step) {
+    stepSimulation(continued, continuedWorkspace, stepTime);
+    stepSimulation(restored, restoredWorkspace, stepTime);
+  }
+  ok &= check(memcmp(continued.velX.data(), restored.velX.data(),
+                     restored.size() * sizeof(float)) == 0 &&
+                  continued.island == restored.island,
+              "restored state steps identically");
+
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "sleeptest passed" << std::endl;
+  return 0;
+}
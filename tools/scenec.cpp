@@ -0,0 +1,34 @@
+// Scene compiler: converts a text scene into the binary format that the
+// simulation maps directly, or back again for inspection.
+//
+//   scenec input.scene output.sceneb
+//   scenec --text input.sceneb output.scene
+#include "scene.h"
+#include <cstring>
+#include <iostream>
+
+int main(int argc, char **argv) {
+  bool toText = argc == 4 && strcmp(argv[1], "--text") == 0;
+  if (argc != 3 && !toText) {
+    std::cerr << "Usage: " << argv[0] << " [--text] <input> <output>"
+              << std::endl;
+    return 1;
+  }
+  const char *input = argv[argc - 2];
+  const char *output = argv[argc - 1];
+
+  SimulationState state;
+  uint64_t seed;
+  if (!loadScene(state, input, &seed)) {
+    return 1;
+  }
+
+  bool ok = toText ? saveSceneText(state, seed, output)
+                   : saveSceneBinary(state, seed, output);
+  if (!ok) {
+    return 1;
+  }
+  std::cout << "Wrote " << state.size() << " spheres to " << output
+            << std::endl;
+  return 0;
+}
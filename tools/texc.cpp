@@ -0,0 +1,67 @@
+// Texture compiler: converts a BMP into a BC1 compressed DDS with a full
+// box filtered mip chain, which the app loads in place of the BMP.
+//
+//   texc input.bmp output.dds
+//   texc --size 1024x512 input.bmp output.dds
+#include "bmp.h"
+#include "dds.h"
+#include "texcompress.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+int main(int argc, char **argv) {
+  int width = 0, height = 0;
+  bool sized = argc == 5 && strcmp(argv[1], "--size") == 0;
+  if ((argc != 3 && !sized) ||
+      (sized && (sscanf(argv[2], "%dx%d", &width, &height) != 2 ||
+                 width <= 0 || height <= 0))) {
+    std::cerr << "Usage: " << argv[0] << " [--size WxH] <input> <output>"
+              << std::endl;
+    return 1;
+  }
+  const char *input = argv[argc - 2];
+  const char *output = argv[argc - 1];
+
+  MappedBMP image;
+  if (!image.open(input)) {
+    return 1;
+  }
+  if (!sized) {
+    width = image.width();
+    height = image.height();
+  }
+
+  // Packed bottom-up pixels at the output size, then halved per level
+  std::vector<unsigned char> pixels(size_t(width) * height * 3);
+  resizeImage(image.bottomRow(), image.width(), image.height(),
+              image.rowStep(), pixels.data(), width, height);
+  image.close();
+
+  int levelCount = mipLevelCount(width, height);
+  std::vector<std::vector<unsigned char>> levels(levelCount);
+  std::vector<unsigned char> next;
+  size_t totalBytes = 0;
+  for (int level = 0, w = width, h = height; level < levelCount; ++level) {
+    levels[level].resize(bc1Size(w, h));
+    compressBC1(pixels.data(), w, h, levels[level].data());
+    totalBytes += levels[level].size();
+    if (level + 1 < levelCount) {
+      next.resize(size_t(std::max(1, w / 2)) * std::max(1, h / 2) * 3);
+      downsampleBox(pixels.data(), w, h, next.data());
+      pixels.swap(next);
+      w = std::max(1, w / 2);
+      h = std::max(1, h / 2);
+    }
+  }
+
+  if (!writeDDS(output, FormatBC1, width, height, levels)) {
+    return 1;
+  }
+  std::cout << "Wrote " << width << "x" << height << " BC1 with "
+            << levelCount << " levels, " << totalBytes << " bytes to "
+            << output << std::endl;
+  return 0;
+}